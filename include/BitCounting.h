@@ -0,0 +1,93 @@
+//
+// File: BitCounting.h
+// Created by: agent
+// Created on: 17 October 2026
+//
+
+/*
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BITCOUNTING_H
+#define	BITCOUNTING_H
+
+#include <stdint.h>
+
+namespace tools {
+/**
+ * @brief Counting set bits in arrays of 64-bit words, as the description elements
+ * (splits, clusters) are stored in PartitionList.
+ * \n The implementation is chosen once, at the program start, depending on the CPU:
+ * AVX-512 VPOPCNTQ (cost matrices only), AVX2 (nibble lookup, Mula's algorithm),
+ * the POPCNT instruction or the portable SWAR algorithm.
+ */
+class BitCounting {
+public:
+    typedef int (*xorCountFunType)(const uint64_t* bitsA, const uint64_t* bitsB, int wordsNum);
+    typedef void (*xorCostMatrixFunType)(const uint64_t* bitsA, int rowsNum, const uint64_t* bitsB, int colsNum,
+                                         int wordsNum, int maxValue, int** costs);
+    /**
+     * @return The number of bits set in the wordsNum words of bits.
+     */
+    static int countSetBits(const uint64_t* bits, int wordsNum);
+    /**
+     * @return The number of bits set in bitsA xor bitsB, where both arrays have wordsNum words.
+     */
+    static int countXorSetBits(const uint64_t* bitsA, const uint64_t* bitsB, int wordsNum)
+    {
+        return xorCountFun(bitsA, bitsB, wordsNum);
+    }
+    /**
+     * @brief The block of a cost matrix between two packed arrays of description elements.
+     * \n costs[r][c] = min(x, maxValue - x), where x = |A_r xor B_c| is the number of bits set 
+     * in the xor of the r-th element of bitsA and the c-th element of bitsB.
+     * For splits maxValue is the number of leaves, for clusters it is INT_MAX.
+     * \n The rows of bitsA are taken in tiles kept in registers while the elements of
+     * bitsB stream past them, so each word of bitsB is loaded once per tile.
+     * @param bitsA     rowsNum elements, the r-th starts at bitsA + r * wordsNum
+     * @param bitsB     colsNum elements, the c-th starts at bitsB + c * wordsNum
+     * @param costs     rows of the result, at least rowsNum x colsNum
+     */
+    static void countXorCostMatrix(const uint64_t* bitsA, int rowsNum, const uint64_t* bitsB, int colsNum,
+                                   int wordsNum, int maxValue, int** costs)
+    {
+        xorCostMatrixFun(bitsA, rowsNum, bitsB, colsNum, wordsNum, maxValue, costs);
+    }
+    /**
+     * @return The name of the implementation chosen for the CPU: "avx512", "avx2", "popcnt" or "generic".
+     */
+    static const char* getImplementationName();
+    /**
+     * @brief Counting bits of a 64bit value. The variable-precision SWAR algorithm.
+     * For delatis see http://graphics.stanford.edu/~seander/bithacks.html#CountBitsSetParallel
+     */
+    static int countSetBits(uint64_t val)
+    {
+        val = val - ((val >> 1) & 0x5555555555555555ULL);
+        val = (val & 0x3333333333333333ULL) + ((val >> 2) & 0x3333333333333333ULL);
+        val = (val + (val >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+        return (int)((val * 0x0101010101010101ULL) >> 56);
+    }
+private:
+    static xorCountFunType xorCountFun;
+    static xorCostMatrixFunType xorCostMatrixFun;
+    static xorCountFunType chooseXorCountFun();
+    static xorCostMatrixFunType chooseXorCostMatrixFun();
+};
+} // end of namespace
+
+#endif	/* BITCOUNTING_H */
@@ -54,6 +54,7 @@ public:
         ClusterElement()
         {
                 valid = false;
+                branchW = 0;
                 lowestElementPos = INT_MIN;
                 highestElementPos = INT_MIN;
                 postorderLeafPos = INT_MIN;
@@ -63,6 +64,7 @@ public:
                 lowestElementPos = oryginal.lowestElementPos;
                 highestElementPos = oryginal.highestElementPos;
                 postorderLeafPos = oryginal.postorderLeafPos;
+                branchW = oryginal.branchW;
                 valid = oryginal.valid;
         }
         bool isElement(int lowest, int highest)
@@ -105,18 +107,30 @@ public:
         }
     };
 private:
-    vector<ClusterElement *> clusterArray;
+    vector<ClusterElement> clusterArray;
     int internalNodesNum;
     double weight;
+    // Values describing the tree the table was built from
+    double tableWeight;
+    // Preallocated stack of Listings used by removeUncommonElements
+    vector<Listing> listingStack;
 
 public:
-    ClusterTable(int leavesSize, PostorderTree& tr);
+    ClusterTable(int leavesSize, const PostorderTree& tr);
     ClusterTable(const ClusterTable& orig);
     virtual ~ClusterTable();
-    ClusterElement * operator[](int pos) { return clusterArray.at(pos); }
-    void removeUncommonElements(PostorderTree& otherTr);
+    ClusterElement * operator[](int pos) { return &clusterArray.at(pos); }
+    /**
+     * @brief Finds the clusters of otherTr that are also in this table.
+     * Afterwards getNumberOfInternalNodes() returns the number of common 
+     * clusters and getWeight() the weighted difference of the trees.
+     * The table itself is not consumed, so the method may be called
+     * repeatedly with successive trees; it does not allocate memory unless
+     * otherTr has more nodes than any tree examined before.
+     */
+    void removeUncommonElements(const PostorderTree& otherTr);
     int getNumberOfInternalNodes() { return internalNodesNum; }
-    int getWeight() { return weight; }
+    double getWeight() { return weight; }
 private:
     int getPostorderPosForNode(int nodeId);
     void markValid(ClusterTable::Listing *listing);
@@ -0,0 +1,140 @@
+//
+// File: HashRF.h
+// Created by: agent
+// Created on: 17 October 2026
+//
+
+/*
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HASHRF_H
+#define	HASHRF_H
+
+#include <stdint.h>
+#include <vector>
+using namespace std;
+#include <Phyl/TreeTemplate.h>
+using namespace bpp;
+#include "TreesManip.h"
+#include "PostorderTree.h"
+#include "PreparedTree.h"
+using namespace tools;
+
+namespace dist {
+/**
+ * @brief The Robinson-Foulds distances between all the pairs of trees in a collection.
+ * \n Every split (unrooted trees) or cluster (rooted trees) of every tree is hashed once
+ * into a global table that maps the split to the list of trees containing it. 
+ * Then the numbers of splits shared by every pair of trees are accumulated in one 
+ * pass over the table and the distance between trees i and j is 
+ * d(i, j) = |S(i)| + |S(j)| - 2 * |S(i) and S(j)|.
+ * \n The hash of a split is the sum of random 64-bit keys of its leaves (universal hashing),
+ * counted bottom-up in the postorder array of a tree, so a tree with n leaves is hashed in O(n).
+ * Two independent 64-bit hashes identify a split, the probability of a false match is 
+ * negligible even for millions of different splits.
+ * \n All the trees must have the same leaves sets and be either all rooted or all unrooted.
+ * \n\n Time complexity: O(N n + sum over splits of k^2), where N is the number of trees and k
+ * is the number of trees containing a split.
+ * \n Algorithm adapted from S.-J. Sul and T. L. Williams, "An experimental analysis of 
+ * Robinson-Foulds distance matrix algorithms", ESA 2008.
+ */
+class HashRF {
+private:
+    /**
+     * @brief A split of the global table.
+     */
+    struct SplitEntry {
+        uint64_t hash1;
+        uint64_t hash2;
+        int treesNum;      // number of trees containing the split
+        int lastTreeId;    // the last tree the split was found in
+    };
+    /**
+     * @brief An element of the stack used to hash a postorder array.
+     */
+    struct HashElement {
+        uint64_t hash1;
+        uint64_t hash2;
+        int nodesNum;       // number of nodes in the subtree
+    };
+    int treesNum;
+    int leavesNum;
+    bool rooted;
+    vector<uint64_t> leafKeys1;
+    vector<uint64_t> leafKeys2;
+    vector<SplitEntry> splits;
+    vector<int> slots;              // open addressing table of positions in splits, -1 if empty
+    vector<int> occurrences;        // positions in splits of the splits of the successive trees
+    vector<size_t> treeOffsets;     // the splits of tree i are occurrences[treeOffsets[i]..treeOffsets[i+1]-1]
+    vector<int> shared;             // upper triangle of the shared splits numbers
+    vector<HashElement> hashStack;
+
+public:
+    /**
+     * @param[in]   trees   The trees prepared with PreparedTree.
+     * @param[in]   seed (optional) Seed of the leaves' random keys.
+     * @throw bpp::Exception if the trees have different numbers of leaves or only some of them are rooted.
+     */
+    HashRF(const vector<PreparedTree*>& trees, unsigned int seed = 1)
+            throw (bpp::Exception);
+    /**
+     * @param[in]   trees   The trees.
+     * @param[in]   setNodesId (optional) TRUE if the trees do not have the same ids for the same leaves 
+     * or the ids are not numbered 0..n-1. Defaults to TRUE.
+     * @param[in]   seed (optional) Seed of the leaves' random keys.
+     * @throw bpp::Exception if the trees have different numbers of leaves or only some of them are rooted.
+     */
+    HashRF(const vector<TreeTemplate<Node>*>& trees, bool setNodesId = true, unsigned int seed = 1)
+            throw (bpp::Exception);
+    virtual ~HashRF();
+
+    /**
+     * @return The Robinson-Foulds distance between the i-th and the j-th tree.
+     */
+    int getDistance(int i, int j) const;
+    int getNumberOfTrees() const { return treesNum; }
+    /**
+     * @return The number of different splits (clusters) in all the trees.
+     */
+    int getNumberOfUniqueSplits() const { return splits.size(); }
+    /**
+     * @return The number of pairs of treesNum trees, i.e. the size of the upper triangle of their distance matrix.
+     */
+    static int64_t getTriangleSize(int treesNum) { return (int64_t)treesNum * (treesNum - 1) / 2; }
+    /**
+     * @return The position of the pair (i, j), i < j, in the upper triangle of the distance matrix 
+     * of treesNum trees stored row by row.
+     */
+    static int64_t getTriangleIndex(int i, int j, int treesNum) { return (int64_t)i * treesNum - (int64_t)i * (i + 1) / 2 + (j - i - 1); }
+
+private:
+    HashRF(const HashRF& orig);
+    HashRF& operator=(const HashRF& orig);
+    void init(int treesNumIn, int leavesNumIn, bool rootedIn, unsigned int seed)
+            throw (bpp::Exception);
+    void checkTree(const TreeTemplate<Node>& tr)
+            throw (bpp::Exception);
+    void addTree(const PostorderTree& pTr);
+    void addSplit(uint64_t hash1, uint64_t hash2);
+    void growSlots();
+    void countSharedSplits();
+    int getSplitsNumber(int treeId) const { return treeOffsets[treeId + 1] - treeOffsets[treeId]; }
+};
+} // end of namespace
+
+#endif	/* HASHRF_H */
@@ -0,0 +1,137 @@
+//
+// File: HierarchicalDecomposition.h
+// Created by: agent
+// Created on: 17 October 2026
+//
+
+/*
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HIERARCHICALDECOMPOSITION_H
+#define	HIERARCHICALDECOMPOSITION_H
+
+#include <stdint.h>
+#include <vector>
+#include <Phyl/TreeTemplate.h>
+using namespace bpp;
+using namespace std;
+
+namespace tools {
+/**
+ * @brief The common part of the O(n log^2 n) quartet and triplet distances of binary trees.
+ * \n The leaves are coloured by the subtree of a node v of tr1 they are in, for every v in turn 
+ * (the "smaller half trick" - the leaves of the larger son keep their colour, so every leaf 
+ * is recoloured O(log n) times), and after each colouring the matching quartets or triplets 
+ * of tr2 are counted in the hierarchical decomposition of tr2.
+ * \n The hierarchical decomposition: every heavy path of tr2 is cut into units (a node of the path 
+ * with the component of its light son), the units are joined pairwise in a tree balanced by the 
+ * numbers of leaves, so every leaf is in O(log n) components. A component has at most two outer 
+ * parts: the rest of the tree above it and the subtree below it (the hole). The subclasses keep 
+ * for every component the number of its counted quartets or triplets as a polynomial of the colours 
+ * counts of the outer parts, a leaf recolouring recounts the components containing the leaf.
+ * \n Adapted from G.S. Brodal, R. Fagerberg, C.N.S. Pedersen. Computing the quartet distance between 
+ * evolutionary trees in time O(n log n). Algorithmica, 38:377–395, 2004, and from A. Sand, M.K. Holt, 
+ * J. Johansen, R. Fagerberg, G.S. Brodal, C.N.S. Pedersen. A practical O(n log^2 n) time algorithm 
+ * for computing the triplet distance on binary trees. BMC Bioinformatics, 14(Suppl 2):S18, 2013.
+ */
+class HierarchicalDecomposition
+{
+protected:
+    static const int COLOURS = 3;
+
+    enum ComponentType {
+        LEAF_COMPONENT,         // a single leaf
+        UNIT_COMPONENT,         // a node of a heavy path with the component of its light son (left), the hole is the heavy son
+        COMPRESSED_COMPONENT    // left (with a hole) above right
+    };
+
+    struct Component
+    {
+        ComponentType type;
+        bool hole;
+        int left;
+        int right;
+        int parent;
+        int poly;               // the index of the polynomial, given by the subclass
+        int cnt[COLOURS];       // the colours counts of the leaves of the component
+    };
+
+    int lSize;
+
+    // tr1 in preorder, 3 sons slots for every node (-1 if none)
+    vector<int> sons1;
+    vector<int> leaves1;        // the leaf id of the node or -1
+    vector<int> subTr1;         // the number of leaves under the node
+    vector<int> firstLeaf1;     // the leaves of the subtree are leavesOrder1[firstLeaf1[v]..firstLeaf1[v] + subTr1[v])
+    vector<int> leavesOrder1;
+
+    // the hierarchical decomposition of tr2
+    vector<Component> components;
+    vector<int> leafComponents; // indexed by the leaf id
+    vector<int> colours;        // indexed by the leaf id
+    int rootComponent;
+
+public:
+    virtual ~HierarchicalDecomposition();
+
+    /**
+     * @return TRUE if the tree can be compared - the root has 2 or 3 sons and the other internal nodes have 2 sons.
+     */
+    static bool isBinary(const TreeTemplate<Node>& tr);
+
+protected:
+    /**
+     * @brief Builds the arrays of tr1 and the decomposition of tr2 (all the leaves with colour 0).
+     * To be called by the subclass constructor.
+     * @param[in] splitRoot2 TRUE if the root of tr2 with 3 sons should be replaced by 2 nodes with 2 sons.
+     * @throw bpp::Exception if any tree is not binary.
+     */
+    void init(const TreeTemplate<Node>& tr1In, const TreeTemplate<Node>& tr2In, bool splitRoot2) throw (Exception);
+
+    /**
+     * @return The index of a new polynomial of a component with or without a hole.
+     */
+    virtual int addPoly(bool hole) = 0;
+    virtual void countUnit(Component& unit) = 0;
+    virtual void countCompressed(Component& comp) = 0;
+    /**
+     * @return The number counted in the whole tr2 for the current colouring.
+     */
+    virtual int64_t getCounted() = 0;
+
+    void setColour(int leaf, int colour);
+    void paint(int v, int colour);
+    /**
+     * @brief Adds to counted getCounted() for every node v of the heavy path starting in top,
+     * with the heavy son of v coloured 1, the light son 2 and the rest of the tree 0.
+     * @param[in] keep TRUE if the subtree of top should be left coloured 1, otherwise it is coloured 0.
+     */
+    void processPath(int top, bool keep, int64_t& counted);
+    int getHeavySon(int v);
+    static int64_t choose2(int64_t a);
+
+private:
+    static void toArrays(const Node* root, bool splitRoot, vector<int>& sons, vector<int>& leaves, vector<int>& subTr) throw (Exception);
+    int buildPath(int top, const vector<int>& sons2, const vector<int>& leaves2, const vector<int>& subTr2);
+    int join(const vector<int>& items, const vector<int>& weightsSum, int begin, int end);
+    int addComponent(ComponentType type, int left, int right);
+    void count(int c);
+};
+
+} // end of namespace
+#endif	/* HIERARCHICALDECOMPOSITION_H */
@@ -0,0 +1,110 @@
+//
+// File: LapWorkspace.h
+// Created by: agent
+// Created on: 17 October 2026
+//
+
+/*
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LAPWORKSPACE_H
+#define	LAPWORKSPACE_H
+
+#include <vector>
+using namespace std;
+
+namespace tools {
+/**
+ * @brief Memory for solving linear assignment problems (see lap() and 
+ * Hungarian::MinWPerfectMatchingCost()) of varying sizes.
+ * \n It holds one contiguous row-major cost buffer together with the solution, 
+ * the dual variables and all the solvers' scratch arrays. The buffers grow only
+ * when a problem larger than any solved before comes, so solving a series of 
+ * problems does not allocate memory after the first (largest) one.
+ * \n A workspace must not be used by two threads at the same time, 
+ * getThreadWorkspace() returns a separate instance for each thread.
+ */
+class LapWorkspace {
+private:
+    int dim;
+    int capacity;
+    vector<int> costs;
+    vector<int*> costRows;
+    vector<int> rowsol;
+    vector<int> colsol;
+    vector<int> u;
+    vector<int> v;
+    // solvers scratch
+    vector<int> freeRows;
+    vector<int> collist;
+    vector<int> matches;
+    vector<int> d;
+    vector<int> pred;
+    vector<long long> prices;
+
+public:
+    LapWorkspace();
+    virtual ~LapWorkspace();
+
+    /**
+     * @brief Prepares the workspace for a dimIn x dimIn problem. 
+     * The buffers are reallocated only if dimIn exceeds the largest dimension so far.
+     * The cost matrix content is not initialized.
+     */
+    void resize(int dimIn);
+    int getDim() const { return dim; }
+    /**
+     * @return The rows of the dim x dim cost matrix. The rows are consecutive 
+     * parts of one buffer (row i starts at getCosts() + i * getDim()).
+     */
+    int** getCostRows() { return &costRows[0]; }
+    /**
+     * The solution and the duals arrays have at least getDim() + 1 elements.
+     */
+    int* getCosts() { return &costs[0]; }
+    int* getRowSolution() { return &rowsol[0]; }
+    int* getColSolution() { return &colsol[0]; }
+    int* getRowDuals() { return &u[0]; }
+    int* getColDuals() { return &v[0]; }
+
+    /*
+     * The solver's scratch arrays, each has at least getDim() + 1 elements.
+     */
+    int* getFreeRows() { return &freeRows[0]; }
+    int* getColList() { return &collist[0]; }
+    int* getMatches() { return &matches[0]; }
+    int* getDistances() { return &d[0]; }
+    int* getPredecessors() { return &pred[0]; }
+    /*
+     * The objects prices of the auction solver, the scaled costs do not fit in int.
+     */
+    long long* getPrices() { return &prices[0]; }
+
+    /**
+     * @return The workspace of the calling thread, created on the first call 
+     * and deleted when the thread exits.
+     */
+    static LapWorkspace& getThreadWorkspace();
+
+private:
+    LapWorkspace(const LapWorkspace& orig);
+    LapWorkspace& operator=(const LapWorkspace& orig);
+};
+} // end of namespace
+
+#endif	/* LAPWORKSPACE_H */
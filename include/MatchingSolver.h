@@ -0,0 +1,137 @@
+//
+// File: MatchingSolver.h
+// Created by: agent
+// Created on: 17 October 2026
+//
+
+/*
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MATCHINGSOLVER_H
+#define	MATCHINGSOLVER_H
+
+#include "LapWorkspace.h"
+
+namespace tools {
+
+/**
+ * @brief A minimum weight perfect matching (linear assignment problem) algorithm.
+ * \n The solvers work on the dim x dim cost matrix stored in a LapWorkspace and 
+ * leave the matching there: getRowSolution()[i] is the column assigned to row i,
+ * getColSolution()[j] the row assigned to column j. The solvers are stateless, 
+ * so one instance may be used by many threads, each with its own workspace.
+ */
+class MatchingSolver {
+public:
+    virtual ~MatchingSolver() {}
+    /**
+     * @return The cost of the minimum weight perfect matching of the workspace's cost matrix (dim >= 1).
+     */
+    virtual int solve(LapWorkspace& workspace) const = 0;
+    virtual const char* getName() const = 0;
+
+    static const MatchingSolver& getJonkerVolgenant();
+    static const MatchingSolver& getHungarian();
+    static const MatchingSolver& getAuction();
+    /**
+     * @brief The policy choosing the solver for the problem stored in the workspace.
+     * \n On the splits, clusters and pairs cost matrices of trees up to 4000 leaves 
+     * the serial auction and the Hungarian algorithm are several times slower than 
+     * Jonker-Volgenant at every size and costs range (1.79 s and 35.7 s against 0.48 s 
+     * for 4000 leaves), so it is the choice. The auction is used only if it is forced 
+     * with PhylotreeDist::setMatchingAlgorithm(), until a multi-core benchmark shows 
+     * where its threaded bids search overtakes Jonker-Volgenant.
+     */
+    static const MatchingSolver& choose(LapWorkspace& workspace);
+};
+
+/**
+ * @brief Jonker and Volgenant shortest augmenting path algorithm, lap().
+ * \n The only solver that leaves the dual variables in the workspace.
+ */
+class JonkerVolgenantSolver : public MatchingSolver {
+public:
+    int solve(LapWorkspace& workspace) const;
+    const char* getName() const { return "Jonker-Volgenant"; }
+};
+
+/**
+ * @brief Hungarian algorithm, Hungarian::MinWPerfectMatchingCost().
+ */
+class HungarianSolver : public MatchingSolver {
+public:
+    int solve(LapWorkspace& workspace) const;
+    const char* getName() const { return "Hungarian"; }
+};
+
+/**
+ * @brief Bertsekas auction algorithm with epsilon-scaling.
+ * \n The rows bid for the columns (objects), the price of an object grows by 
+ * the bidder's margin over its second best object plus epsilon. 
+ * The costs are multiplied by dim + 1, so the last phase (epsilon = 1) 
+ * ends with an assignment within dim / (dim + 1) < 1 of the optimum, 
+ * which for integer costs means the exact optimum. 
+ * Each phase starts with the prices of the previous one, epsilon is divided by EPSILON_FACTOR.
+ * \n With more than one thread (setThreadsNumber()) and at least PARALLEL_MIN_DIMENSION 
+ * columns, every bid is searched by all the threads, each in its own part of the columns.
+ * The parts are merged in the columns order, so the bids, and the solution, are the same 
+ * as in the serial search. The threads spin between the bids (yielding the processor 
+ * after SPINS_BEFORE_YIELD checks), each bid costs only two synchronizations.
+ * A spinning thread needs a processor of its own, so no more threads than the online 
+ * processors are used (getBiddingThreadsNumber()).
+ * \n The speed-up of the threads has not been measured on a multi-core machine yet, 
+ * so MatchingSolver::choose() never picks the auction, it has to be forced.
+ */
+class AuctionSolver : public MatchingSolver {
+public:
+    int solve(LapWorkspace& workspace) const;
+    const char* getName() const { return "Auction"; }
+
+    /**
+     * @brief Sets the number of threads that search the bids of one problem (1 by default).
+     */
+    static void setThreadsNumber(int threadsNum) { threadsNumber = threadsNum < 1 ? 1 : threadsNum; }
+    static int getThreadsNumber() { return threadsNumber; }
+    /**
+     * @return The number of threads searching the bids of the large problems: 
+     * getThreadsNumber() limited by the number of the online processors.
+     */
+    static int getBiddingThreadsNumber();
+
+    static const int EPSILON_FACTOR = 5;
+    static const int PARALLEL_MIN_DIMENSION = 1024;
+    static const int SPINS_BEFORE_YIELD = 1000;
+private:
+    struct BidSearch;
+    struct Bidding;
+    struct BiddingWorker;
+
+    static int threadsNumber;
+
+    /**
+     * @return The difference between the largest and the smallest cost of the workspace's matrix.
+     */
+    static long long getCostsRange(LapWorkspace& workspace);
+
+    static void runPhase(Bidding& bidding);
+    static void searchBid(Bidding& bidding, int workerId);
+    static void* bid(void* worker);
+};
+
+} // end of namespace
+#endif	/* MATCHINGSOLVER_H */
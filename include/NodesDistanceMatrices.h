@@ -32,25 +32,109 @@ using namespace bpp;
 using namespace std;
 
 namespace tools {
+/**
+ * @brief The path lengths between the leaves of a tree, counted row by row.
+ * \n The tree is walked once without recursion and kept in flat arrays (O(n) memory):
+ * the depth and the father of each node and the leaves in the visiting order, so the leaves
+ * under a node are consecutive. The row of leaf i (the path lengths from i to all the leaves)
+ * is then counted in O(n): going up from i, the leaves of each ancestor v not under the former
+ * one have their lca in v, so their path is depth(i) + depth(j) - 2 * depth(v).
+ * \n For a tree compared with many others cacheRows() keeps all the rows (O(n^2) memory).
+ */
+class LeavesPaths {
+private:
+    int leavesNum;
+    bool weighted;
+    // the nodes are indexed in the visiting order (preorder), the root is 0
+    vector<int> father;
+    vector<double> depth;       // the sum of the branch lengths from the root, weighted trees only
+    vector<int> level;          // the number of edges from the root, unweighted trees only
+    vector<int> firstLeaf;
+    vector<int> endLeaf;
+    vector<int> leafNode;       // the node of a leaf, indexed by the leaf id
+    vector<int> leavesOrder;    // the leaves ids in the visiting order
+    // the cached rows, leavesNum x leavesNum, of the type of the tree's path lengths
+    vector<double> rows;
+    vector<int> levelRows;
+
+public:
+    /**
+     * @param[in] weighted If true, the edges have their lengths, otherwise 1.
+     */
+    LeavesPaths(const TreeTemplate<Node>& tr, bool weighted);
+    int getNumberOfLeaves() const { return leavesNum; }
+    bool isWeighted() const { return weighted; }
+    /**
+     * @brief Counts all the rows once, getRow() returns them from now on.
+     */
+    void cacheRows();
+    bool hasCachedRows() const { return !rows.empty() || !levelRows.empty(); }
+    /**
+     * @brief The row of a weighted tree.
+     * @param[in] buffer At least getNumberOfLeaves() values, filled if the rows are not cached.
+     * @return The path lengths from the leaf leafId to the leaves, indexed by the leaves ids.
+     */
+    const double* getRow(int leafId, double* buffer) const;
+    /**
+     * @brief The row of an unweighted tree, the path lengths are the numbers of edges.
+     */
+    const int* getRow(int leafId, int* buffer) const;
+
+private:
+    struct Visit;
+    template <class Length> 
+    void countRow(int leafId, const vector<Length>& depths, Length* row) const;
+};
+
 /**
  * @brief The abstract class for nodal distances algorithms.
+ * \n The path lengths are not stored as matrices: the rows of both trees are counted
+ * one at a time, so the distance needs O(n) memory besides the cached rows.
+ * \n The sums for k = 1 and k = 2 have their own kernels without pow(), AVX2 or generic 
+ * ones chosen for the CPU (see BitCounting). The unweighted path lengths are int rows summed 
+ * exactly in 64 bits. The weighted rows are summed in the same order by both kernels and 
+ * the rows sums are added with the compensated (Kahan-Neumaier) summation.
  */
 class INodesDist {
 protected:
     int k;
-    vector <vector <double> > tr1NDists;
-    vector <vector <double> > tr2NDists;
+    LeavesPaths* tr1Paths;
+    LeavesPaths* tr2Paths;
 public:
+    INodesDist();
+    virtual ~INodesDist();
     virtual void init(const TreeTemplate<Node> &tr1, const TreeTemplate<Node> &tr2) = 0;
     double getDistance();
+    /**
+     * @return (sum over the leaves pairs i < j of |path1(i, j) - path2(i, j)|^k)^(1/k)
+     * @throw Exception if only one of the paths is weighted.
+     */
+    static double getDistance(const LeavesPaths& paths1, const LeavesPaths& paths2, int k)
+            throw (Exception);
+    /**
+     * @return The name of the kernels for k = 1 and k = 2 chosen for the CPU: "avx2" or "generic".
+     */
+    static const char* getImplementationName();
+    /**
+     * @brief Switches between the generic kernels (true) and the ones chosen for the CPU (false, the default),
+     * e.g. to compare them. Must not be called while any distance is being counted.
+     */
+    static void forceGenericImplementation(bool generic);
+    /**
+     * @return TRUE if the generic kernels are forced with forceGenericImplementation().
+     */
+    static bool isGenericImplementationForced();
+protected:
+    void setPaths(const TreeTemplate<Node> &tr1, const TreeTemplate<Node> &tr2, bool weighted);
+private:
+    INodesDist(const INodesDist& orig);
+    INodesDist& operator=(const INodesDist& orig);
 };
 
 /**
  * @brief Nodal distance algorithm for weighted trees.
  */
 class WeigthedNodesDist : public INodesDist  {
-private:
-    void getTreeNodesDists(TreeTemplate<Node>& tr, vector<vector <double> >& trNDists);
 public:
     WeigthedNodesDist(int kIn);
     void init(const TreeTemplate<Node> &tr1, const TreeTemplate<Node> &tr2);
@@ -60,8 +144,6 @@ public:
  * @brief Nodal distance algorithm for unweighted trees.
  */
 class UnWeigthedNodesDist : public INodesDist  {
-private:
-    void getTreeNodesDists(TreeTemplate<Node>& tr, vector<vector <double> >& trNDists);
 public:
     UnWeigthedNodesDist(int kIn);
     void init(const TreeTemplate<Node> &tr1, const TreeTemplate<Node> &tr2);
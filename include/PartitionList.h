@@ -29,6 +29,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <vector>
 #include <Phyl/TreeTemplate.h>
 #include <cmath>
+#include <stdint.h>
 using namespace std;
 using namespace bpp;
 
@@ -43,28 +44,51 @@ namespace tools
 class PartitionList
 {
 protected:
-    vector<int *> bitList;
-    int intCount;
-    static const int BITS_IN_INT;
-    int* browseTree(Node* root);
+    /*
+     * Each partition is a sequence of wordsCount 64-bit words, bit i set if the
+     * leaf of id i belongs to the partition. All the partitions are stored one
+     * after another in one aligned block (see getWords()).
+     */
+    vector<uint64_t *> bitList;
+    uint64_t* words;
+    int wordsCount;
+    int capacity;               // number of partitions the words block has room for
+    static const int BITS_IN_WORD;
+    void browseTree(const Node* root);
 public:
     PartitionList();
     ~PartitionList();
-    PartitionList(int count);
+    /**
+     * @param count     the number of leaves
+     * @param capacity  the maximal number of partitions
+     */
+    PartitionList(int count, int capacity);
     /**
      *  O(n^2 logn)
      **/        
-    const vector<int *>& getBitList();
+    const vector<uint64_t *>& getBitList() const;
     int size() const;
+    /**
+     * @return The number of 64-bit words of a partition.
+     */
+    int getWordsCount() const { return wordsCount; }
+    /**
+     * @return The packed partitions: the i-th partition starts at getWords() + i * getWordsCount().
+     * The block is 32-bytes aligned.
+     */
+    const uint64_t* getWords() const { return words; }
+protected:
+    void removeLast();
 private:
+    PartitionList(const PartitionList& orig);
+    PartitionList& operator=(const PartitionList& orig);
     /*
      * This bases on the fact that the trees have the same leaves ids
      */
-    void setLeafBit(int leafId, int* clusterBitList);
-    void joinBits(int *cl1, const int *cl2);
+    void setLeafBit(int leafId, uint64_t* clusterBitList);
+    void joinBits(uint64_t *cl1, const uint64_t *cl2);
 
-    int* browseTree_do(Node* root);
-    vector<int *> leavesBitList;
+    uint64_t* browseTree_do(const Node* root);
 }; 
 
 
@@ -30,6 +30,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <cstring>
 #include <Phyl/BipartitionList.h>
 #include "PartitionList.h"
+#include "BitCounting.h"
 using namespace std;
 using namespace bpp;
 
@@ -44,21 +45,19 @@ class ITwoTreesDescriptionElements
 {    
 public:
     /**
-     * @brief Counts a cost matrix and reverses its values:
+     * @brief Counts a cost matrix:
      * - cost is the distance between a pair of splits where the pair incldes
      * one split from T1 and one from T2.
-     * - each finally returned in the cost matrix value equals (maxCost - value).
-     * This is done to find minimum weight perfect matching by a Hungarian (Maximum
-     * Weight Perfect Matching) algorithm.
      *
      * O(n^3) == O(n^2*countDistance complexity)
      * @param costMatrix - a matrix that would store the result.
      */
     virtual int getCostMatrix(int** costMatrix) = 0;
     virtual int getSize() = 0;
-
-    virtual int fixReversedWeightsSum(int sum) = 0;
-    virtual void getCostReversedMatrix(vector<vector<int> >& costMatrix) = 0;
+    /**
+     * @return A lower bound of the minimum weight perfect matching cost known without the cost matrix.
+     */
+    virtual int getLowerBound() { return 0; }
 };
 /****************************k-leaves Subsets*************************/
 /**
@@ -68,89 +67,44 @@ public:
 class LeavesSets : public ITwoTreesDescriptionElements
 {
 protected:   
-    class LeavesList
+    /**
+     * @brief A tree as the list of its internal nodes. 
+     * \n An internal node's generational index (0..size-1) is its position in the postorder
+     * of the internal nodes, so the sons of a node have smaller indices than the node.
+     * The leaves are ranked in the order the postorder visits them, the leaves under an internal 
+     * node have consecutive ranks.
+     */
+    struct InternalNodes
     {
-    private:
-        struct Element
-        {
-        public:
-            Element(int valIn)
-            {
-                val = valIn;
-                next = NULL;
-            }
-            int val;
-            Element* next;
-        };
-
-        Element* first;
-        Element* last;
-        int listSize;
-        Element* iterator;
-    public:
-        LeavesList(int val)
-        {
-            first = new Element(val);
-            last = first;
-            listSize = 1;
-        }
-        ~LeavesList()
-        {
-            Element* el = first;
-            while (el != NULL) {
-                Element* elNext = el->next;
-                delete el;
-                el = elNext;
-            }
-            delete el;
-        }
-        int size()
-        {
-            return listSize;
-        }
-        void concat(LeavesList* other)
-        {
-            last->next = other->first;
-            last = other->last;
-            listSize += other->size();
-        }
-        void resetIteration()
-        {
-            iterator = first;
-        }
-        int nextId()
-        {
-            if (iterator == NULL) throw Exception("LeavesList's iterator out of range");
-            int val = iterator->val;
-            iterator = iterator->next;
-            return val;
-        }
-        bool iterationFinished()
-        {
-            return iterator == NULL;
-        }
+        // The sons of the node i are sons[sonsBegin[i]] .. sons[sonsBegin[i + 1] - 1]: 
+        // a generational index or -1 - id for a leaf
+        vector<int> sons;
+        vector<int> sonsBegin;
+        // The leaves under the node i have the ranks firstLeaf[i] .. firstLeaf[i] + subLeavesNum[i] - 1
+        vector<int> firstLeaf;
+        vector<int> subLeavesNum;
+        vector<int> leafRank;           // leafRank[leaf id]
+        // The number of the leaves pairs the node i is the last common ancestor of
+        vector<int> pairsNum;
+        int size() const { return firstLeaf.size(); }
     };
-    // Matrices of size: number of leaves. They keep the internal node's generational indice.
-    // The splitNode1[i][j] informs what is the generational index and level in the tree1
-    // at which two leaves of id i and j split. 
-    // A generational index is a value 0..inNodesNum-1 assigned to n internal node during browseTree.
-    // It has no other usage than to be the smallest possible distinctive internal node description.
-    vector<vector<int> > splitNode1;        
-    vector<vector<int> > splitNode2;        
-    int inNodesNum;                 // the number internal nodes
+    InternalNodes nodes1;
+    InternalNodes nodes2;
+    int inNodesNum;                 // the larger number of internal nodes
     int leavesNum;
 public:
     virtual int getCostMatrix(int** costMatrix) = 0; 
-
-    virtual void getCostReversedMatrix(vector<vector<int> >& costMatrix) = 0;
-    virtual int fixReversedWeightsSum(int sum) = 0;
 private:
-    virtual LeavesList* browseTree(int rootId, const TreeTemplate<Node>& tr, int& rootIndex, vector<vector<int> >& splitNode) = 0;
+    virtual int browseTree(int rootId, const TreeTemplate<Node>& tr, InternalNodes& nodes, int& leafRank) = 0;
 };
 
 /**
  * @brief Two description elements operations, where a description element is 
  * a two-elements subset of leaves with specified size.\n
+ * The trees may be multifurcating. A node of degree k is the last common ancestor of the pairs 
+ * of leaves from two different of its k subtrees. If the trees have different numbers 
+ * of internal nodes, the smaller set is padded with the dummy (empty) elements, 
+ * the cost of matching an element with a dummy one is the number of its pairs.
  */
 class PairLeavesSets : public LeavesSets
 {
@@ -158,10 +112,29 @@ public:
     PairLeavesSets(const TreeTemplate<Node> &tr1, const TreeTemplate<Node> &tr2);        
     int getSize();        
     int getCostMatrix(int** costMatrix); 
-    void getCostReversedMatrix(vector<vector<int> >& costMatrix);        
-    int fixReversedWeightsSum(int sum);        
 private:
-    LeavesList* browseTree(int rootId, const TreeTemplate<Node>& tr, int& rootIndex, vector<vector<int> >& splitNode);
+    int browseTree(int rootId, const TreeTemplate<Node>& tr, InternalNodes& nodes, int& leafRank);
+    /**
+     * @brief Fills the nodes1.size() x nodes2.size() part of the table with the numbers of the leaves pairs 
+     * whose last common ancestor is the node a in tree1 and the node b in tree2, 
+     * without listing the pairs (O(n^2) time, O(1) memory besides the table).
+     * \n First table[a][b] = |L1(a) & L2(b)|, the number of common leaves under a and b, 
+     * row by row in the postorder of tree1: a row is the sum of its sons rows, 
+     * a leaf son adds 1 to the nodes b of tree2 it is under (a leaf rank range test).
+     * The pairs under both a and b are P(a, b) = |L1(a) & L2(b)| choose 2. 
+     * The sons' leaves sets are disjoint, so by inclusion-exclusion over the sons a_i of a 
+     * and b_j of b the pairs that are split exactly at a and b are
+     * P(a, b) - sum_i P(a_i, b) - sum_j P(a, b_j) + sum_i,j P(a_i, b_j),
+     * where P is 0 for a leaf. This is done in place in the reversed postorders, 
+     * so the intersections the formula needs are not overwritten yet.
+     * The sum over all the nodes of deg(a) * deg(b) keeps it O(n^2) for any degrees.
+     */
+    void fillPairsContingency(int** table);
+    /**
+     * @return P(a, b) for the nodes a, b given as in InternalNodes::sons, 0 if any is a leaf.
+     */
+    int getCommonPairs(int** table, int a, int b) const;
+    int getSubLeavesNum(const InternalNodes& nodes, int son) const;
 };
 
 
@@ -178,16 +151,23 @@ public:
         GMS2
     };
 private:
-    typedef int (Partitioning::*methodPtr)(int* bitBipart);
+    typedef int (Partitioning::*methodPtr)(const uint64_t* bitBipart);
     methodPtr dummyFun;
 protected:
-    PartitionList *pl1;
-    PartitionList *pl2;
-    static const int BITS_IN_INT;
-    vector<int *> largerBitList;
-    vector<int *> smallerBitList;
+    const PartitionList *pl1;
+    const PartitionList *pl2;
+    bool ownsLists;             // false if pl1 and pl2 come from the caller (e.g. from a PreparedTree)
+    vector<uint64_t *> largerBitList;
+    vector<uint64_t *> smallerBitList;
+    const uint64_t* largerWords;    // the packed elements of largerBitList
+    const uint64_t* smallerWords;   // the packed elements of smallerBitList
+    vector<uint64_t> largerResidualWords;
+    vector<uint64_t> smallerResidualWords;
+    int commonElementsNum;
+    bool complementEqual;       // true if an element equals its complement (splits)
     int taxonNum_or_MaxInt;
     int taxonsNumber;
+    int wordsNum;               // number of 64-bit words of a description element
     /**
      * @brief Each bipartition is a sequence of bits corresponding to the trees
      * the bipartitions come from. That trees have the same leaves set.
@@ -199,36 +179,45 @@ protected:
      * the dist is 0.5 min{ |A1xorB1|+|A2xorB2|, |A1xorB2|+|A2xorB1| } which equals to
      *  min {|A1|+|B1|-2|A1&B1|, leavesSize - |A1|+|B1|-2|A1&B1|}
      *
-     * @param bipA - the array of bits of (leavesSize / sizeof(int) + 1) size. If a bit
+     * @param bipA - the array of wordsNum 64-bit words. If a bit
      * is set it means that a leaf that corresponds to the bit belongs to the bipartition.
-     * @param bipB - the array of bits of (leavesSize / sizeof(int) + 1) size. If a bit
+     * @param bipB - the array of wordsNum 64-bit words. If a bit
      * is set it means that a leaf that corresponds to the bit belongs to the bipartition.
      * @param leavesSize - the number of leaves of the tree bipartition bipA comes from which
      * is equal to the number leaves of the tree bipartition bipb comes from.
      *
      * @return The distance between bipA and bipB
      */
-    virtual int countDistance(int *bitDescrEl1, int *bitDescrEl2) = 0;
-    int dummyFunction1(int* unused);
-    int dummyFunction2(int* bitBipart);
-    void setInitFields(const TreeTemplate<Node>& tr1, dummyFunType d);
+    virtual int countDistance(const uint64_t *bitDescrEl1, const uint64_t *bitDescrEl2) = 0;
+    int dummyFunction1(const uint64_t* unused);
+    int dummyFunction2(const uint64_t* bitBipart);
+    void setInitFields(int taxonsNum, dummyFunType d);
     /**
-     * @brief Counting bits of a 32bit value. The variable-precision SWAR algorithm.
-     * For delatis see http://graphics.stanford.edu/~seander/bithacks.html#CountBitsSetParallel
-     * @param val - the 32bit value of which the number of set bits is count.
-     * @return The number of set bits
+     * @brief Removes the pairs of identical description elements (one from each tree) 
+     * from largerBitList and smallerBitList. 
+     * \n The distance between identical elements is 0 and the distance satisfies the 
+     * triangle inequality (also for the dummy elements), so there is an optimal 
+     * matching in which the identical elements are matched with each other. 
+     * Only the rest of the elements have to be matched by the LAP solver.
+     * The identical elements are found with a hash table of the smaller list.
      */
-    static int getNumberOfSetBits(int val)
-    {
-        val = val - ((val >> 1) & 0x55555555);
-        val = (val & 0x33333333) + ((val >> 2) & 0x33333333);
-        return ((val + (val >> 4) & 0xF0F0F0F) * 0x1010101) >> 24;
-    }
+    void removeCommonElements();
+    uint64_t getCanonicalWord(const uint64_t* bits, int i) const;
+    uint64_t hashElement(const uint64_t* bits) const;
+    bool equalElements(const uint64_t* bits1, const uint64_t* bits2) const;
 public:
-    int fixReversedWeightsSum(int sum);
-    void getCostReversedMatrix(vector<vector<int> >& costMatrix);        
     int getCostMatrix(int** costMatrix);
     int getSize();
+    /**
+     * @brief The Robinson-Foulds derived bound: every element of the smaller list left after
+     * removeCommonElements() is matched with a different element of the other tree, which costs at least 1.
+     * For two binary trees it is half of the Robinson-Foulds distance.
+     */
+    int getLowerBound();
+    /**
+     * @return The number of pairs of identical elements removed before the matching.
+     */
+    int getCommonElementsNumber() { return commonElementsNum; }
     ~Partitioning();
 };
 
@@ -242,9 +231,13 @@ class Splitting : public Partitioning
 {
 public:
     Splitting(const TreeTemplate<Node>& tr1, const TreeTemplate<Node>& tr2, dummyFunType d = GMS2);
+    /**
+     * @brief Compares two already built lists of splits. The lists are not copied nor deleted.
+     */
+    Splitting(const PartitionList& splits1, const PartitionList& splits2, int taxonsNum, dummyFunType d = GMS2);
 
 private:
-    int countDistance(int *bipA, int *bipB);
+    int countDistance(const uint64_t *bipA, const uint64_t *bipB);
 };
 
 /**
@@ -257,8 +250,12 @@ class Clustering : public Partitioning
 {
 public:
     Clustering(const TreeTemplate<Node>& tr1, const TreeTemplate<Node>& tr2, dummyFunType d = GMS1);
+    /**
+     * @brief Compares two already built lists of clusters. The lists are not copied nor deleted.
+     */
+    Clustering(const PartitionList& clusters1, const PartitionList& clusters2, int taxonsNum, dummyFunType d = GMS1);
 private:
-    int countDistance(int *bipA, int *bipB);	
+    int countDistance(const uint64_t *bipA, const uint64_t *bipB);
 };
 
 
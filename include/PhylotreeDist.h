@@ -33,11 +33,17 @@ using namespace bpp;
 #include "ClusterTable.h"
 #include "Partitioning.h"
 #include "QuartetDistance.h"
+#include "QuartetDistanceHDT.h"
 #include "TripletDistance.h"
+#include "TripletDistanceHDT.h"
 #include "NodesDistanceMatrices.h"
+#include "PreparedTree.h"
+#include "RFReference.h"
+#include "HashRF.h"
 
 #include "Hungarian.h"
 #include "hungarianJV/lap.h"
+#include "MatchingSolver.h"
 //#include "QPartitionList.h"
 using namespace tools;
 
@@ -47,6 +53,40 @@ namespace dist {
  */
 class PhylotreeDist {    
 public:
+    /**
+     * @brief The algorithms solving the minimum weight perfect matching in the perfectMatching_* distances.
+     */
+    enum MatchingAlgorithm {
+        AUTO_SELECTION,         // MatchingSolver::choose() decides for each matrix, the default
+        JONKER_VOLGENANT,       // lap()
+        HUNGARIAN_ALGORITHM,    // Hungarian::MinWPerfectMatchingCost(), the default if compiled with -DHUNGARIAN
+        AUCTION_ALGORITHM       // AuctionSolver
+    };
+    static void setMatchingAlgorithm(MatchingAlgorithm algorithm) { matchingAlgorithm = algorithm; }
+    static MatchingAlgorithm getMatchingAlgorithm() { return matchingAlgorithm; }
+
+    /**
+     * @brief The algorithms counting the quartetDistance.
+     */
+    enum QuartetAlgorithm {
+        QUARTET_AUTO_SELECTION,             // the hierarchical decomposition one for bifurcating trees, the arbitrary degree one otherwise, the default
+        QUARTET_ARBITRARY_DEGREE,           // QuartetDistance
+        QUARTET_HIERARCHICAL_DECOMPOSITION  // QuartetDistanceHDT, bifurcating trees only
+    };
+    static void setQuartetAlgorithm(QuartetAlgorithm algorithm) { quartetAlgorithm = algorithm; }
+    static QuartetAlgorithm getQuartetAlgorithm() { return quartetAlgorithm; }
+
+    /**
+     * @brief The algorithms counting the tripletsDistance.
+     */
+    enum TripletAlgorithm {
+        TRIPLET_AUTO_SELECTION,             // the hierarchical decomposition one for bifurcating trees, the arbitrary degree one otherwise, the default
+        TRIPLET_ARBITRARY_DEGREE,           // Triplets
+        TRIPLET_HIERARCHICAL_DECOMPOSITION  // TripletsHDT, bifurcating trees only
+    };
+    static void setTripletAlgorithm(TripletAlgorithm algorithm) { tripletAlgorithm = algorithm; }
+    static TripletAlgorithm getTripletAlgorithm() { return tripletAlgorithm; }
+
     /**
      * @brief The RobinsonFoulds distance between two unrooted or rooted, multifurcating trees with the same set of leaves.
      * \n The RobinsonFoulds metric bases on counting occurrences of:
@@ -98,7 +138,7 @@ public:
      * \n\n Time complexity: O(n^3)
      * \n Algorithm adapted from D. Bogdanowicz and K. Giaro. Comparing arbitrary unrooted phylogenetic trees using generalized matching split distance. In Information Technology (ICIT), 2010 2nd International Conference on, pages 259–262. IEEE, 2010.
      *
-     * \n By default the minimum weight perfect matching is computed by an external library that bases on Jonker and Volgenant algorithm. If during compilation there is a preprocessor HUNGARIAN symbol defined (-DHUNGARIAN), then there is a Knuth’s Hungarian algorithm used
+     * \n By default the algorithm computing the minimum weight perfect matching (Jonker and Volgenant, Knuth’s Hungarian or Bertsekas auction) is chosen by MatchingSolver::choose() for each cost matrix. One of them can be forced with setMatchingAlgorithm() (the Hungarian one is forced if the preprocessor HUNGARIAN symbol is defined during compilation, -DHUNGARIAN)
      *  
      * @param[in]   tr1     First unrooted tree.
      * @param[in]   tr2     Second unrooted tree.
@@ -120,7 +160,7 @@ public:
      * \n\n Time complexity: O(n^3)
      * \n Algorithm main assumptions base on D. Bogdanowicz and K. Giaro. Comparing arbitrary unrooted phylogenetic trees using generalized matching split distance. In Information Technology (ICIT), 2010 2nd International Conference on, pages 259–262. IEEE, 2010.
      *
-     * \n By default the minimum weight perfect matching is computed by an external library that bases on Jonker and Volgenant algorithm. If during compilation there is a preprocessor HUNGARIAN symbol defined (-DHUNGARIAN), then there is a Knuth’s Hungarian algorithm used
+     * \n By default the algorithm computing the minimum weight perfect matching (Jonker and Volgenant, Knuth’s Hungarian or Bertsekas auction) is chosen by MatchingSolver::choose() for each cost matrix. One of them can be forced with setMatchingAlgorithm() (the Hungarian one is forced if the preprocessor HUNGARIAN symbol is defined during compilation, -DHUNGARIAN)
 
      * \n The minimum weight perfect matching algorithm is a Knuth's Hyngarian algorithm adapted from Mordecai J. Golin which implementation base on Bipartite matching and the hungarian method. Hong Kong University of Science and Technology Course Notes http://www.cse.ust.hk/~golin/COMP572/Notes/Matching.pdf/.
      * \n Simultaneously there is a Jonker and Volgenant algorithm that solves the linear assignment problem: there is used an external library from http://www.assignmentproblems.com/LAPJV.htm.
@@ -142,26 +182,51 @@ public:
      * A description element corresponds to an internal node and is a set of all the pairs of leaves to which the node is the last common ancestor. 
      * \n The weight on an edge that links two sets of pairs A1 and A2 is the number of pairs that occur in exactly one of the two description elements’ set of unordered pairs. 
      * Formally, h(A1 , A2 ) = |(A1 or A2 ) \ (A1 and A2 |) = |A1 xor A2 |
+     * \n The trees may be multifurcating: a node of degree k is the last common ancestor of the pairs of leaves from two different of its subtrees. 
+     * If the numbers of internal nodes differ, the missing elements are empty sets of pairs (matching an element with one costs the number of its pairs).
 
      * \n The constraints for the two input trees: Either the same leaves id sets numbered 0..n-1 and internal nodes ids numbered n, n+1,...  or the same leaves name sets and setLeavesId parameter true
      * \n\n Time complexity: O(n^3)
      * \n Algorithm main assumptions base on D. Bogdanowicz and K. Giaro. Comparing arbitrary unrooted phylogenetic trees using generalized matching split distance. In Information Technology (ICIT), 2010 2nd International Conference on, pages 259–262. IEEE, 2010.
-     * \n By default the minimum weight perfect matching is computed by an external library that bases on Jonker and Volgenant algorithm. If during compilation there is a preprocessor HUNGARIAN symbol defined (-DHUNGARIAN), then there is a Knuth’s Hungarian algorithm used	 
+     * \n By default the algorithm computing the minimum weight perfect matching (Jonker and Volgenant, Knuth’s Hungarian or Bertsekas auction) is chosen by MatchingSolver::choose() for each cost matrix. One of them can be forced with setMatchingAlgorithm() (the Hungarian one is forced if the preprocessor HUNGARIAN symbol is defined during compilation, -DHUNGARIAN)	 
      *
      * \n The minimum weight perfect matching algorithm is a Knuth's Hyngarian algorithm
                              * adapted from Hong Kong University of Science and Technology Course Notes http://www.cse.ust.hk/~golin/COMP572/Notes/Matching.pdf/.
                              * Simltaneously there is used an external library from http://www.assignmentproblems.com/LAPJV.htm. It bases on Jonker and Volgenant algorithm that solves the linear assignment problem.
      * 
-     * @param[in]   tr1     First rooted binary tree.
-     * @param[in]   tr2     Second rooted binary tree.
+     * @param[in]   tr1     First rooted tree.
+     * @param[in]   tr2     Second rooted tree.
      * @param[in]   setLeavesId (optional) TRUE if the two trees do not have the same ids for the same leaves or the ids are not numbered 0..n-1. Defaults to TRUE.
-     * @param[in]   checkNames (optional) TRUE if check whether trees have the same leaves set and whether is binary, rooted. Defaults to FALSE.
+     * @param[in]   checkNames (optional) TRUE if check whether trees have the same leaves set and whether is rooted. Defaults to FALSE.
      * @return      minimum weight perfect matching split distance
      * @throw bpp::Exception if trees have different leaves sets.
      */
     static int perfectMatching_pairs(const TreeTemplate<Node>& trIn1, const TreeTemplate<Node>& trIn2, bool setLeavesId = true, bool checkNames = true)
             throw (bpp::Exception);
 
+    /**
+     * @brief Decides whether the matching distance is at most threshold, 
+     * solving the matching only if cheap bounds do not decide it.
+     * \n The bounds, in the order they are tried:
+     * - (splits, clusters) the Robinson-Foulds lower bound: each not common element costs at least 1, 
+     * known before the cost matrix is counted (ITwoTreesDescriptionElements::getLowerBound()),
+     * - the row-min plus col-min reduction lower bound: u[i] = min_j c[i][j], v[j] = min_i (c[i][j] - u[i])
+     * are feasible dual variables of the assignment problem, so sum(u) + sum(v) does not exceed its optimum
+     * (at the optimum the sum of the duals lap() returns equals it),
+     * - the upper bound: the cost of the greedy assignment (each row takes the cheapest free column).
+     * 
+     * \n They are the choice for near-duplicates detection or k-nearest neighbours queries, 
+     * where most of the pairs are far above the threshold.
+     * The parameters and the constraints are the same as in perfectMatching_splits, _clusters and _pairs.
+     * @return TRUE if the distance is not greater than threshold.
+     */
+    static bool perfectMatching_splits_bounded(const TreeTemplate<Node>& trIn1, const TreeTemplate<Node>& trIn2, int threshold, bool setLeavesId = true, bool checkNames = false)
+            throw (bpp::Exception);
+    static bool perfectMatching_clusters_bounded(const TreeTemplate<Node>& trIn1, const TreeTemplate<Node>& trIn2, int threshold, bool setLeavesId = true, bool checkNames = false)
+            throw (bpp::Exception);
+    static bool perfectMatching_pairs_bounded(const TreeTemplate<Node>& trIn1, const TreeTemplate<Node>& trIn2, int threshold, bool setLeavesId = true, bool checkNames = true)
+            throw (bpp::Exception);
+
 
      /**
      * @brief The  Quartet distance between two unrooted trees with the same set of leaves.
@@ -170,15 +235,18 @@ public:
      * \n The constraints for the two input trees: Either the same leaves id sets numbered 0..n-1 and internal nodes ids numbered n, n+1,...  or the same leaves name sets and setLeavesId parameter true
      * \n\n Time complexity: O(n + |V1||V2| deg1max ^ 2 deg2max) where V is the number of internal nodes, degmax is the maximal internal node degree.
      * \n Algorithm adapted from C. Christiansen, T. Mailund, C. Pedersen, and M. Randers. Computing the quartet distance between trees of arbitrary degree. Algorithms in Bioinformatics, pages 77–88, 2005.
+     * \n For two bifurcating trees the distance is counted by default in time O(n log^2 n) and memory O(n) with QuartetDistanceHDT 
+     * (the hierarchical decomposition of G.S. Brodal, R. Fagerberg, C.N.S. Pedersen, 2004). One of the algorithms can be forced with setQuartetAlgorithm().
      *
      * @param[in] tr1 First unrooted tree.
      * @param[in] tr2 Second unrooted tree.
      * @param[in] setLeavesId (optional) TRUE if the two trees do not have the same ids for the same leaves or the ids are not numbered 0..n-1. 
      * @param[in] checkNames (optional) TRUE if check whether trees have the same leaves set and whether is unrooted. Defaults to FALSE.
      * @return The quartet distance between trees.
-     * @throw bpp::Exception if trees have different leaves sets or any is rooted.
+     * @throw bpp::Exception if trees have different leaves sets or any is rooted, 
+     * or any is multifurcating and QUARTET_HIERARCHICAL_DECOMPOSITION is forced.
      */                 
-    static int quartetDistance(const TreeTemplate<Node>& trIn1, const TreeTemplate<Node>& trIn2, bool setLeavesId = true, bool checkNames = false)
+    static int64_t quartetDistance(const TreeTemplate<Node>& trIn1, const TreeTemplate<Node>& trIn2, bool setLeavesId = true, bool checkNames = false)
             throw (Exception);
 
     /**
@@ -190,15 +258,18 @@ public:
      * \n The constraints for the two input trees: Either the same leaves id sets numbered 0..n-1 and internal nodes ids numbered n, n+1,...  or the same leaves name sets and setLeavesId parameter true
      * \n\n Time complexity: O(n^2)
      * \n Algorithm adapted from D.E. Critchlow, D.K. Pearl, and C. Qian. The triplets distance for rooted bifurcating phylogenetic trees. Systematic biology, 45(3):323, 1996.
+     * \n For two bifurcating trees the distance is counted by default in time O(n log^2 n) and memory O(n) with TripletsHDT 
+     * (A. Sand et al., 2013). One of the algorithms can be forced with setTripletAlgorithm().
      *
      * @param[in] tr1 First rooted bifurcating tree.
      * @param[in] tr2 Second rooted bifurcating tree.
      * @param[in] setLeavesId (optional) TRUE if the two trees do not have the same ids for the same leaves or the ids are not numbered 0..n-1. 
      * @param[in] checkNames (optional) TRUE if check whether trees have the same leaves set and whether is binary, rooted. Defaults to FALSE.
      * @return The triplets distance between trees.
-     * @throw bpp::Exception if trees have different leaves sets or any is unrooted.
+     * @throw bpp::Exception if trees have different leaves sets or any is unrooted, 
+     * or any is multifurcating and TRIPLET_HIERARCHICAL_DECOMPOSITION is forced.
      */
-    static int tripletsDistance(const TreeTemplate<Node> & trIn1, const TreeTemplate<Node> & trIn2, bool setLeavesId = true, bool checkNames = false)
+    static int64_t tripletsDistance(const TreeTemplate<Node> & trIn1, const TreeTemplate<Node> & trIn2, bool setLeavesId = true, bool checkNames = false)
             throw (Exception);
 
 
@@ -289,8 +360,79 @@ public:
             throw (Exception);
 
 
+    /*
+     * The distances between trees prepared with PreparedTree. 
+     * Each method counts the same as the method of the same name for TreeTemplate<Node>,
+     * but the leaves ids ordering and the structures derived from a single tree 
+     * (postorder array, splits/clusters, subtree sizes) are taken from the PreparedTree
+     * instead of being built on every call. 
+     * They are the choice when the same trees are compared many times, e.g. in matrix mode.
+     */
+    static int robinsonFoulds(const PreparedTree& tr1, const PreparedTree& tr2, bool checkNames = false) 
+            throw (bpp::Exception);
+    static double robinsonFouldsW(const PreparedTree& tr1, const PreparedTree& tr2, bool checkNames = false) 
+            throw (bpp::Exception);
+    static int perfectMatching_splits(const PreparedTree& tr1, const PreparedTree& tr2, bool checkNames = false)
+            throw (bpp::Exception);
+    static int perfectMatching_clusters(const PreparedTree& tr1, const PreparedTree& tr2, bool checkNames = false)
+            throw (bpp::Exception);
+    static int perfectMatching_pairs(const PreparedTree& tr1, const PreparedTree& tr2, bool checkNames = true)
+            throw (bpp::Exception);
+    static bool perfectMatching_splits_bounded(const PreparedTree& tr1, const PreparedTree& tr2, int threshold, bool checkNames = false)
+            throw (bpp::Exception);
+    static bool perfectMatching_clusters_bounded(const PreparedTree& tr1, const PreparedTree& tr2, int threshold, bool checkNames = false)
+            throw (bpp::Exception);
+    static bool perfectMatching_pairs_bounded(const PreparedTree& tr1, const PreparedTree& tr2, int threshold, bool checkNames = true)
+            throw (bpp::Exception);
+    static int64_t quartetDistance(const PreparedTree& tr1, const PreparedTree& tr2, bool checkNames = false)
+            throw (Exception);
+    static int64_t tripletsDistance(const PreparedTree& tr1, const PreparedTree& tr2, bool checkNames = false)
+            throw (Exception);
+    static int nodalDistance(const PreparedTree& tr1, const PreparedTree& tr2, bool checkNames = false)
+            throw (Exception);
+    static double nodalDistance_pythagorean(const PreparedTree& tr1, const PreparedTree& tr2, bool checkNames = false)
+            throw (Exception);
+    static double nodalDistanceW(const PreparedTree& tr1, const PreparedTree& tr2, bool checkNames = false)
+            throw (Exception);
+    static double nodalDistanceW_pythagorean(const PreparedTree& tr1, const PreparedTree& tr2, bool checkNames = false)
+            throw (Exception);
+    /**
+     * @brief The Nodal distances between one tree and many trees, all prepared with PreparedTree.
+     * \n The path lengths of the reference tree are counted once and cached (O(n^2) memory), 
+     * the ones of each other tree are counted row by row (O(n) memory). The results are the same 
+     * as of nodalDistance(), nodalDistance_pythagorean(), nodalDistanceW() and nodalDistanceW_pythagorean().
+     * @param[in] weighted  TRUE for the branch weighted variants.
+     * @param[in] k         1 for the manhattan metric, 2 for the pythagorean one.
+     * @return The distances between the reference and trees[i], in the trees order.
+     */
+    static vector<double> nodalDistances(const PreparedTree& reference, const vector<PreparedTree*>& trees, bool weighted, int k, bool checkNames = false)
+            throw (Exception);
+
+    /**
+     * @brief The minimum weight perfect matching distance for already built description elements
+     * (e.g. Splitting, Clustering, PairLeavesSets), solved in the given workspace.
+     * \n The perfectMatching_* methods use the workspace of the calling thread 
+     * (LapWorkspace::getThreadWorkspace()), so repeated calls do not allocate the cost matrix again.
+     */
+    static int getPMDistance(ITwoTreesDescriptionElements& descriptionElements, LapWorkspace& workspace);
+    /**
+     * @return The solver used for the cost matrix stored in the workspace: the forced one
+     * (setMatchingAlgorithm()) or the one chosen by MatchingSolver::choose().
+     */
+    static const MatchingSolver& getMatchingSolver(LapWorkspace& workspace);
+    /**
+     * @brief The bounded version of getPMDistance(), see perfectMatching_splits_bounded().
+     * \n The reduction duals are left in the workspace (getRowDuals(), getColDuals()) 
+     * unless the matching is solved or the Robinson-Foulds bound decides.
+     * @return TRUE if the matching distance is not greater than threshold.
+     */
+    static bool isPMDistanceWithin(ITwoTreesDescriptionElements& descriptionElements, int threshold, LapWorkspace& workspace);
 
 private:
+    static MatchingAlgorithm matchingAlgorithm;
+    static QuartetAlgorithm quartetAlgorithm;
+    static TripletAlgorithm tripletAlgorithm;
+
     static bool checkLeavesNames(const TreeTemplate<Node>& trIn1, const TreeTemplate<Node>& trIn2)
             throw (bpp::Exception);
 
@@ -299,11 +441,20 @@ private:
 
     static int getPMDistance(ITwoTreesDescriptionElements& descriptionElements);
 
+    static bool useQuartetHDT(const TreeTemplate<Node>& tr1, const TreeTemplate<Node>& tr2)
+            throw (bpp::Exception);
+
+    static bool useTripletsHDT(const TreeTemplate<Node>& tr1, const TreeTemplate<Node>& tr2)
+            throw (bpp::Exception);
+
     static void getTreeNodesDists(TreeTemplate<Node>& tr, vector<vector <int> >& trNDists);
 
     static double getNodalDistance(INodesDist *d, const TreeTemplate<Node>& tr1, const TreeTemplate<Node>& tr2, bool setLeavesId = true, bool checkNames = false)
             throw (Exception);    
 
+    static double getNodalDistance(INodesDist *d, const PreparedTree& tr1, const PreparedTree& tr2, bool checkNames = false)
+            throw (Exception);    
+
 };
 } // end of namespace
 #endif	/* PHYLOTREEDIST_H */
@@ -41,27 +41,15 @@ namespace tools {
      * and internal nodes).
      */
 class PostorderTree {
-public:
-    /**
-     * @brief Structure of a node of PostorderTree that stores information 
-     * about the real id of a node and the number of its descendants.
-     */
-    class NodeAgent {
-    public:
-        int nodeId;
-        int subNodesSize;       // number of node's descendants
-        double branchW;         // branch weight
-        NodeAgent(int nodeId, int leavesSize, double branchWIn)
-        {
-            this->nodeId = nodeId;
-            this->subNodesSize = leavesSize;
-            this->branchW = branchWIn;
-        }
-    };
-    typedef vector<NodeAgent*>::iterator iterator;
-    typedef vector<NodeAgent*>::const_iterator const_iterator;
 private:
-    vector<NodeAgent*> postorderNodes;
+    /*
+     * The postorder array is kept as a structure of arrays: position i of
+     * every vector describes the i-th node in postorder. The last position
+     * holds a fake node for the purposes of Day's R-F algorithm.
+     */
+    vector<int> nodeId;             // real id of a node
+    vector<int> subNodesSize;       // number of node's descendants
+    vector<double> branchW;         // branch weight
     bool isWeighted;
 
 public:
@@ -69,8 +57,9 @@ public:
      * @brief During a DFS search of a tree that root is given as parameter,
      * a node x on which searching is finished (there is no more child to
      * examine) obtains a successive position in a PSW array and this position
-     * is its pswId. Under this position, the array stores data about the
-     * node in NodeAgent class: node’s original label and the number of node’s descendants.
+     * is its pswId. Under this position, the arrays store node’s original label,
+     * the number of node’s descendants and the weight of the node's branch.
+     * The input tree is neither copied nor modified.
      * @param[in]   root    root to the bpp:Tree that will be the base for the new PostorderTree.
      * @param[in]   isWeightedIn    informs whether input tree is weighted.
      */
@@ -78,15 +67,25 @@ public:
     PostorderTree(const PostorderTree& orig);
     virtual ~PostorderTree();
     static void rootTree(TreeTemplate<Node>& tr);
-    NodeAgent* operator[](int pos);
-    iterator begin() { return postorderNodes.begin(); }
-    const_iterator begin() const { return postorderNodes.begin(); }
-    iterator end() { return postorderNodes.end() - 1; }
-    const_iterator end() const { return postorderNodes.end() - 1; }
-    NodeAgent* getNodeAgent(int pos);
-    int getNumberOfNodes();
+    int getNodeId(int pos) const { return nodeId[pos]; }
+    int getSubNodesSize(int pos) const { return subNodesSize[pos]; }
+    double getBranchW(int pos) const { return branchW[pos]; }
+    /**
+     * @brief Raw access to the postorder arrays. Each array has 
+     * getNumberOfNodes() + 1 elements, the last one describes the fake node.
+     */
+    const int* getNodeIds() const { return &nodeId[0]; }
+    const int* getSubNodesSizes() const { return &subNodesSize[0]; }
+    const double* getBranchWeights() const { return &branchW[0]; }
+    int getNumberOfNodes() const;
 private:
-    int setPostorderList(Node& root);
+    struct DfsElement {
+        const Node* node;
+        int nextSon;
+        int firstPos;
+    };
+    void setPostorderList(const Node* root);
+    void addNode(int id, int subSize, double w);
 
 };
 } // end of namespace
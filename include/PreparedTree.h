@@ -0,0 +1,88 @@
+//
+// File: PreparedTree.h
+// Created by: agent
+// Created on: 17 October 2026
+//
+
+/*
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PREPAREDTREE_H
+#define	PREPAREDTREE_H
+#include <vector>
+using namespace std;
+#include <Phyl/TreeTemplate.h>
+using namespace bpp;
+#include "TreesManip.h"
+#include "PostorderTree.h"
+#include "PartitionList.h"
+
+namespace tools {
+/**
+ * @brief A tree preprocessed once to be compared with many other trees.
+ * \n It stores the tree with ordered nodes ids (see TreesManip::createOrderedTrees) 
+ * together with the structures the metrics derive from it:
+ * \n  - the postorder array for the O(n) Robinson-Foulds algorithm (built on the 
+ *       rooted copy of the tree if the tree is unrooted, see PostorderTree::rootTree),
+ * \n  - the bitset list of the splits (unrooted tree) or clusters (rooted tree) 
+ *       for the matching distances,
+ * \n  - the number of leaves in the subtree of each node.
+ * 
+ * \n Comparing N trees pairwise with the PreparedTree handles costs O(N) preprocessing
+ * instead of O(N^2). All the trees compared with each other must have the same leaves sets.
+ */
+class PreparedTree {
+private:
+    TreeTemplate<Node>* orderedTree;
+    // orderedTree rooted as Day's algorithm needs it. The same as orderedTree for rooted trees.
+    TreeTemplate<Node>* rootedTree;
+    PostorderTree* postorderTree;
+    PartitionList* partitions;
+    vector<int> subTrSizes;
+
+public:
+    /**
+     * @param[in]   trIn    The tree to prepare.
+     * @param[in]   setLeavesId (optional) TRUE if the tree leaves ids are not numbered 
+     * 0..n-1 in the alphabetical order of the leaves names. Defaults to TRUE.
+     */
+    PreparedTree(const TreeTemplate<Node>& trIn, bool setLeavesId = true);
+    virtual ~PreparedTree();
+
+    const TreeTemplate<Node>& getTree() const { return *orderedTree; }
+    const TreeTemplate<Node>& getRootedTree() const { return *rootedTree; }
+    const PostorderTree& getPostorderTree() const { return *postorderTree; }
+    /**
+     * @return The splits if the tree is unrooted, the clusters otherwise.
+     */
+    const PartitionList& getPartitions() const { return *partitions; }
+    /**
+     * @return The number of leaves in the subtree of each node, indexed by the node id.
+     */
+    const vector<int>& getSubtreeSizes() const { return subTrSizes; }
+    bool isRooted() const { return orderedTree->isRooted(); }
+    int getNumberOfLeaves() const { return orderedTree->getNumberOfLeaves(); }
+
+private:
+    PreparedTree(const PreparedTree& orig);
+    PreparedTree& operator=(const PreparedTree& orig);
+    void countSubtreeSizes(const Node* root);
+};
+} // end of namespace
+
+#endif	/* PREPAREDTREE_H */
@@ -25,7 +25,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef QPARTETS_H
 #define	QPARTETS_H
 #include <Phyl/TreeTemplate.h>
-#include <list>
+#include <vector>
+#include <stdint.h>
+#include "PreparedTree.h"
 using namespace bpp;
 using namespace std;
 
@@ -40,20 +42,33 @@ class TreeParams2
 private:
     int inSize;
     int lSize;
-    list<int>* inSons;    
+    // the internal sons of v are inSonsIds[inSonsBegin[v]..inSonsBegin[v + 1])
+    int* inSonsBegin;
+    int* inSonsIds;
     int* subTr;
     int rootId;
+    int* inFather;      // the father of an internal node (-1 for the root)
+    int* leafFather;    // the father of a leaf, indexed by the leaf id
+    int* inPostorder;   // the internal nodes, the sons before the father
+    // the leaves under v are leavesOrder[firstLeaf[v]..firstLeaf[v] + subTr[v])
+    int* firstLeaf;
+    int* leavesOrder;
     
 public:
-    TreeParams2(Node* root, int n, int l);
+    /**
+     * @param[in] subTrSizes (optional) The number of leaves under each node, indexed by the node id. 
+     * If not given, it is counted.
+     */
+    TreeParams2(Node* root, int n, int l, const vector<int>* subTrSizes = NULL);
     ~TreeParams2();
     
 private:    
-    static int choose2(int a);
-    static int choose3(int a);    
-    int countSubTrSize(Node* r);
-    //collecting sons being internal nodes. Attantion! Internal nodes have ids >= l
-    void setInSons(Node* root, int rootNewId);
+    static int64_t choose2(int a);
+    static int64_t choose3(int a);    
+    //walking the tree without recursion. Attantion! Internal nodes have ids >= l
+    void setNodes(Node* root, bool countSubTr);
+    const int* sonsBegin(int v) const { return inSonsIds + inSonsBegin[v]; }
+    const int* sonsEnd(int v) const { return inSonsIds + inSonsBegin[v + 1]; }
 };
 
 
@@ -67,10 +82,32 @@ private:
  * C. Christiansen, T. Mailund, C. Pedersen, and M. Randers. Computing
  * the quartet distance between trees of arbitrary degree. Algorithms in
  * Bioinformatics, 3692:77–88, 2005.
+ * \n The rows (the internal nodes v1 of tr1) of the intersection matrix and of the sums over 
+ * the pairs (v1, v2) are independent. With more than one thread (setThreadsNumber()) and at least 
+ * PARALLEL_MIN_NODES internal nodes in tr1 the threads take the rows one by one, each sums 
+ * its own part. The parts are integers added in the threads order, so the result does not 
+ * depend on the threads number.
  */
 class QuartetDistance
 {
 private:    
+    /**
+     * The sums of the products of the pairs numbers - they are up to n^4 before the final division
+     * and do not fit 64 bits for the largest trees.
+     */
+    __extension__ typedef __int128 QuartetSum;
+
+    enum RowsKernel {
+        INTERSECTION_ROWS,
+        SHARED_ROWS,
+        NONSHARED_ROWS
+    };
+    struct RowsScratch;
+    struct RowsJob;
+    struct RowsWorker;
+
+    static int threadsNumber;
+
     TreeParams2 *trP1;
     TreeParams2 *trP2;
     int ** intersection;
@@ -79,28 +116,44 @@ private:
     Node* r2;
 
 public:
+    /**
+     * @brief Sets the number of threads counting one distance (1 by default).
+     */
+    static void setThreadsNumber(int threadsNum) { threadsNumber = threadsNum < 1 ? 1 : threadsNum; }
+    static int getThreadsNumber() { return threadsNumber; }
+    static const int PARALLEL_MIN_NODES = 256;
+
     QuartetDistance(const TreeTemplate<Node>& tr1In, const TreeTemplate<Node>& tr2In);
+    QuartetDistance(const PreparedTree& tr1In, const PreparedTree& tr2In);
     ~QuartetDistance();    
-    int getDistance();    
-    int getNonshared();
-    int getShared();
+    int64_t getDistance();    
+    int64_t getNonshared();
+    int64_t getShared();
 
 private:
-    int getSingleTrQuartetsSize(int size, int* subTrsize, list<int>* inSons);
-    int binomCoef_bin(int a);
-    int non_product(int i, int j);
-    int a_b(int i, int j);
-    int aneg_bneg(int i, int j);
-    int a_bneg(int i, int j);
-    int aneg_b(int i, int j);
+    void init(const TreeTemplate<Node>& tr1In, const TreeTemplate<Node>& tr2In, const vector<int>* subTrSizes1, const vector<int>* subTrSizes2);
+    int64_t getSingleTrQuartetsSize(const TreeParams2* trP);
+    int64_t binomCoef_bin(int a);
+    int64_t a_b(int i, int j);
+    int64_t aneg_bneg(int i, int j);
+    int64_t a_bneg(int i, int j);
+    int64_t aneg_b(int i, int j);
     int in_a_b(int i, int j);
     int in_aneg_bneg(int i, int j);
     int in_a_bneg(int i, int j);
     int in_aneg_b(int i, int j);    
-    int countIntersection(Node* root1, Node* root2);    
-    int binomCoef_n_2(int x);
+    int64_t binomCoef_n_2(int x);
+
+    QuartetSum runRows(RowsKernel kernel);
+    static void* processRows(void* worker);
+    /**
+     * @brief Counts intersection[v1][v2] = |leaves(v1) ^ leaves(v2)| for all v2: every leaf of v1 
+     * is added at its father in tr2, then the counts are summed up the tree.
+     */
+    void countIntersectionRow(int v1);
+    QuartetSum getSharedRow(int v1, RowsScratch& scratch);
+    QuartetSum getNonsharedRow(int v1, RowsScratch& scratch);
 };
 
 } // end of namespace
 #endif	/* QPARTITIONLIST_H */
-
@@ -0,0 +1,102 @@
+//
+// File: QuartetDistanceHDT.h
+// Created by: agent
+// Created on: 17 October 2026
+//
+
+/*
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef QUARTETDISTANCEHDT_H
+#define	QUARTETDISTANCEHDT_H
+
+#include <stdint.h>
+#include <vector>
+#include <Phyl/TreeTemplate.h>
+#include "PreparedTree.h"
+#include "HierarchicalDecomposition.h"
+using namespace bpp;
+using namespace std;
+
+namespace tools {
+/**
+ * @brief Computing the Quartet distance between two unrooted binary trees in O(n log^2 n).
+ * \n A quartet ab|cd is counted at the node v of tr1 where a and b meet the path to c and d:
+ * a, b and {c, d} are in the three different subtrees around v. For every colouring 
+ * of the leaves by the subtrees of v the quartets of tr2 of the form ab|cd with a, b, c 
+ * of different colours and d of the colour of c are counted (see HierarchicalDecomposition). 
+ * Every shared quartet is counted twice (at both ends of its middle path in tr1), all the quartets 
+ * of binary trees are resolved, so the distance is C(n, 4) - shared.
+ * \n The counts are kept in 64 bits - for up to about 10^5 leaves.
+ */
+class QuartetDistanceHDT : public HierarchicalDecomposition
+{
+private:
+    /**
+     * @brief The counted quartets of a component without a hole, as a polynomial of the colours
+     * counts U[k] of the rest of the tree: c + sum u[k] U[k] + sum uu[k] C(U[k], 2).
+     */
+    struct FreePoly
+    {
+        int64_t c;
+        int64_t u[COLOURS];
+        int64_t uu[COLOURS];
+    };
+
+    /**
+     * @brief The counted quartets of a component with a hole, as a polynomial of the colours counts 
+     * U[k] of the rest of the tree and H[k] of the hole: the FreePoly monomials of U and of H, 
+     * uh[i][j] U[i] H[j], uuh[k][i] C(U[k], 2) H[i] and uhh[i][k] U[i] C(H[k], 2).
+     */
+    struct HolePoly
+    {
+        int64_t c;
+        int64_t u[COLOURS];
+        int64_t h[COLOURS];
+        int64_t uu[COLOURS];
+        int64_t hh[COLOURS];
+        int64_t uh[COLOURS][COLOURS];
+        int64_t uuh[COLOURS][COLOURS];
+        int64_t uhh[COLOURS][COLOURS];
+    };
+
+    vector<FreePoly> freePolys;
+    vector<HolePoly> holePolys;
+
+public:
+    /**
+     * @throw bpp::Exception if any tree is not binary.
+     */
+    QuartetDistanceHDT(const TreeTemplate<Node>& tr1In, const TreeTemplate<Node>& tr2In) throw (Exception);
+    QuartetDistanceHDT(const PreparedTree& tr1In, const PreparedTree& tr2In) throw (Exception);
+    ~QuartetDistanceHDT();
+    int64_t getDistance();
+    /**
+     * @return The number of quartets with the same topology in both trees.
+     */
+    int64_t getShared();
+
+private:
+    int addPoly(bool hole);
+    void countUnit(Component& unit);
+    void countCompressed(Component& comp);
+    int64_t getCounted();
+};
+
+} // end of namespace
+#endif	/* QUARTETDISTANCEHDT_H */
@@ -0,0 +1,104 @@
+//
+// File: RFReference.h
+// Created by: agent
+// Created on: 17 October 2026
+//
+
+/*
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef RFREFERENCE_H
+#define	RFREFERENCE_H
+
+#include <vector>
+#include <string>
+using namespace std;
+#include <Phyl/TreeTemplate.h>
+using namespace bpp;
+#include "TreesManip.h"
+#include "PostorderTree.h"
+#include "ClusterTable.h"
+#include "PreparedTree.h"
+using namespace tools;
+
+namespace dist {
+/**
+ * @brief The Robinson-Foulds distance between one reference tree and many other trees.
+ * \n The postorder array and the cluster table of the reference tree are built once,
+ * in the constructor, so scoring a query tree costs only the query's own O(n) 
+ * preprocessing and one pass of Day's algorithm (see PhylotreeDist::robinsonFoulds).
+ * \n The query trees must have the same leaves set as the reference tree and be 
+ * rooted if and only if the reference tree is rooted.
+ * \n The object reuses its internal buffers, so one instance must not be used by 
+ * several threads at the same time.
+ */
+class RFReference {
+private:
+    // Reference tree with ordered nodes ids, rooted as Day's algorithm needs it
+    TreeTemplate<Node>* refTree;
+    PostorderTree* postorderTree;
+    ClusterTable* clusters;
+    vector<string> leavesNames;
+    bool rooted;
+    int refNodesNum;
+    int leavesNum;
+
+public:
+    /**
+     * @param[in]   refIn   The reference tree.
+     * @param[in]   setNodesId (optional) TRUE if the tree leaves ids are not numbered 0..n-1 
+     * in the alphabetical order of the leaves names. Defaults to TRUE.
+     */
+    RFReference(const TreeTemplate<Node>& refIn, bool setNodesId = true);
+    RFReference(const PreparedTree& refIn);
+    virtual ~RFReference();
+
+    /**
+     * @brief The Robinson-Foulds distance between the reference tree and trIn.
+     * @param[in]   trIn    The query tree.
+     * @param[in]   setNodesId (optional) TRUE if the query tree's leaves ids are not numbered 0..n-1
+     * in the alphabetical order of the leaves names. Defaults to TRUE.
+     * @param[in]   checkNames (optional) TRUE if check whether the trees have the same leaves set. Defaults to FALSE.
+     * @return      Robinson-Foulds distance
+     * @throw bpp::Exception if trees have different leaves sets or only one of them is rooted.
+     */
+    int getDistance(const TreeTemplate<Node>& trIn, bool setNodesId = true, bool checkNames = false)
+            throw (bpp::Exception);
+    int getDistance(const PreparedTree& tr, bool checkNames = false)
+            throw (bpp::Exception);
+    /**
+     * @brief The Robinson-Foulds distances between the reference tree and each of the trees.
+     * @return      Vector of distances in the order of the input trees.
+     */
+    vector<int> getDistances(const vector<TreeTemplate<Node>*>& trees, bool setNodesId = true, bool checkNames = false)
+            throw (bpp::Exception);
+
+    const TreeTemplate<Node>& getReferenceTree() const { return *refTree; }
+    bool isRooted() const { return rooted; }
+
+private:
+    RFReference(const RFReference& orig);
+    RFReference& operator=(const RFReference& orig);
+    void init(const vector<string>& names);
+    void checkQuery(const TreeTemplate<Node>& trIn, bool checkNames)
+            throw (bpp::Exception);
+    int getDistance(const PostorderTree& pTr, int nodesNum);
+};
+} // end of namespace
+
+#endif	/* RFREFERENCE_H */
@@ -26,8 +26,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define	TRIPLETS_H
 
 #include <Phyl/TreeTemplate.h>
-#include <list>
 #include <cstring>
+#include <stdint.h>
+#include "PreparedTree.h"
 using namespace bpp;
 using namespace std;
 namespace tools {
@@ -40,23 +41,35 @@ class TreeParams
 private:
     int inSize;
     int lSize;
-    list<int>* inSons;    
+    // the internal sons of v are inSonsIds[inSonsBegin[v]..inSonsBegin[v + 1])
+    int* inSonsBegin;
+    int* inSonsIds;
     int* subTr;
     int rootId;
+    int* inFather;      // the father of an internal node (-1 for the root)
+    int* leafFather;    // the father of a leaf, indexed by the leaf id
+    int* inPostorder;   // the internal nodes, the sons before the father
+    // the leaves under v are leavesOrder[firstLeaf[v]..firstLeaf[v] + subTr[v])
+    int* firstLeaf;
+    int* leavesOrder;
     
 public:
-    TreeParams(Node* root, int n, int l);
+    /**
+     * @param[in] subTrSizes (optional) The number of leaves under each node, indexed by the node id. 
+     * If not given, it is counted.
+     */
+    TreeParams(Node* root, int n, int l, const vector<int>* subTrSizes = NULL);
     ~TreeParams();
-    int getResolved();
-    int getUnresolved(int R);
+    int64_t getResolved();
+    int64_t getUnresolved(int64_t R);
     
 private:
-    int getResolved_in(int id);
-    static int choose2(int a);
-    static int choose3(int a);
-    int countSubTrSize(Node* r);
-    //collecting sons being internal nodes. Attantion! Internal nodes have ids >= l
-    void setInSons(Node* root, int rootNewId);
+    static int64_t choose2(int a);
+    static int64_t choose3(int a);
+    //walking the tree without recursion. Attantion! Internal nodes have ids >= l
+    void setNodes(Node* root, bool countSubTr);
+    const int* sonsBegin(int v) const { return inSonsIds + inSonsBegin[v]; }
+    const int* sonsEnd(int v) const { return inSonsIds + inSonsBegin[v + 1]; }
 };
 
     
@@ -77,14 +90,16 @@ private:
     
 public:
     Triplets(const TreeTemplate<Node>& tr1In, const TreeTemplate<Node>& tr2In);
+    Triplets(const PreparedTree& tr1In, const PreparedTree& tr2In);
     ~Triplets();
-    int getDistance();
+    int64_t getDistance();
     
 private:    
-    int countIntersection(Node* root1, Node* root2, int** intersection);
-    int getSameResolved();
-    int getResolvedT1();
-    int ro(int u2, int u, int v);
+    void init(const TreeTemplate<Node>& tr1In, const TreeTemplate<Node>& tr2In, const vector<int>* subTrSizes1, const vector<int>* subTrSizes2);
+    void countIntersectionRow(int v1);
+    int64_t getSameResolved();
+    int64_t getResolvedT1();
+    int64_t ro(int u2, int u, int v);
     int b_nega(int b, int a);
 };
 
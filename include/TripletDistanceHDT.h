@@ -0,0 +1,87 @@
+//
+// File: TripletDistanceHDT.h
+// Created by: agent
+// Created on: 17 October 2026
+//
+
+/*
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TRIPLETDISTANCEHDT_H
+#define	TRIPLETDISTANCEHDT_H
+
+#include <stdint.h>
+#include <vector>
+#include <Phyl/TreeTemplate.h>
+#include "PreparedTree.h"
+#include "HierarchicalDecomposition.h"
+using namespace bpp;
+using namespace std;
+
+namespace tools {
+/**
+ * @brief Computing the Triplets distance between two rooted binary trees in O(n log^2 n) and memory O(n).
+ * \n A triplet ab|c is counted at its last common ancestor v in tr1: a and b are in one son of v, 
+ * c in the other. For every colouring of the leaves by the sons of v the triplets of tr2 of the form 
+ * ab|c with a, b of one colour and c of the other one are counted (see HierarchicalDecomposition). 
+ * Every shared triplet is counted once, all the triplets of binary trees are resolved, 
+ * so the distance is C(n, 3) - shared.
+ * \n Adapted from A. Sand, M.K. Holt, J. Johansen, R. Fagerberg, G.S. Brodal, C.N.S. Pedersen. 
+ * A practical O(n log^2 n) time algorithm for computing the triplet distance on binary trees. 
+ * BMC Bioinformatics, 14(Suppl 2):S18, 2013.
+ */
+class TripletsHDT : public HierarchicalDecomposition
+{
+private:
+    /**
+     * @brief The counted triplets of a component with a hole, as a polynomial of the colours counts 
+     * H[k] of the hole: c + sum h[k] H[k] + sum hh[k] C(H[k], 2) (the rest of the tree does not 
+     * matter - a triplet is counted at its last common ancestor). Only the colours 1 and 2 are used.
+     */
+    struct HolePoly
+    {
+        int64_t c;
+        int64_t h[COLOURS];
+        int64_t hh[COLOURS];
+    };
+
+    vector<int64_t> freeCounts;     // the counted triplets of the components without a hole
+    vector<HolePoly> holePolys;
+
+public:
+    /**
+     * @throw bpp::Exception if any tree is not binary.
+     */
+    TripletsHDT(const TreeTemplate<Node>& tr1In, const TreeTemplate<Node>& tr2In) throw (Exception);
+    TripletsHDT(const PreparedTree& tr1In, const PreparedTree& tr2In) throw (Exception);
+    ~TripletsHDT();
+    int64_t getDistance();
+    /**
+     * @return The number of triplets with the same topology in both trees.
+     */
+    int64_t getShared();
+
+private:
+    int addPoly(bool hole);
+    void countUnit(Component& unit);
+    void countCompressed(Component& comp);
+    int64_t getCounted();
+};
+
+} // end of namespace
+#endif	/* TRIPLETDISTANCEHDT_H */
@@ -8,6 +8,8 @@
    header file for LAP
 *
 **************************************************************************/
+#include "LapWorkspace.h"
+
 namespace tools {
 
 /*************** CONSTANTS  *******************/
@@ -25,6 +27,10 @@ namespace tools {
 extern int lap(int dim, int **assigncost,
                int *rowsol, int *colsol, int *u, int *v);
 
+// Solves the problem stored in the workspace, using its scratch memory.
+// The solution and the dual variables are left in the workspace.
+extern int lap(LapWorkspace& workspace);
+
 extern void checklap(int dim, int **assigncost,
                      int *rowsol, int *colsol, int *u, int *v);
 
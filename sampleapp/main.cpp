@@ -30,17 +30,19 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <Phyl/Newick.h>
 #include <Phyl/Tree.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <deque>
 
 using namespace std;
 using namespace dist;
 using namespace bpp;
 
 
-string countDistance_int(int (*metricFun)(const TreeTemplate<Node>&, const TreeTemplate<Node>&, bool, bool), TreeTemplate<Node> *t1, TreeTemplate<Node> *t2, bool constr)
+string countDistance_int(int (*metricFun)(const PreparedTree&, const PreparedTree&, bool), PreparedTree *t1, PreparedTree *t2, bool constr)
 {
     stringstream ss;
     try {
-        ss << metricFun(*t1, *t2, false, constr);
+        ss << metricFun(*t1, *t2, constr);
     } catch (bpp::Exception e) { 
         ss << e.what();
     } catch (exception e) { 
@@ -49,11 +51,24 @@ string countDistance_int(int (*metricFun)(const TreeTemplate<Node>&, const TreeT
     return ss.str(); 
 }
 
-string countDistance_double(double (*metricFun)(const TreeTemplate<Node>&, const TreeTemplate<Node>&, bool, bool), TreeTemplate<Node> *t1, TreeTemplate<Node> *t2, bool constr)
+string countDistance_int64(int64_t (*metricFun)(const PreparedTree&, const PreparedTree&, bool), PreparedTree *t1, PreparedTree *t2, bool constr)
+{
+    stringstream ss;
+    try {
+        ss << metricFun(*t1, *t2, constr);
+    } catch (const bpp::Exception& e) { 
+        ss << e.what();
+    } catch (const exception& e) { 
+        ss << e.what();
+    }
+    return ss.str(); 
+}
+
+string countDistance_double(double (*metricFun)(const PreparedTree&, const PreparedTree&, bool), PreparedTree *t1, PreparedTree *t2, bool constr)
 {
     stringstream ss;    
     try {
-        ss << metricFun(*t1, *t2, false, constr);
+        ss << metricFun(*t1, *t2, constr);
     } catch (bpp::Exception e) { 
         ss << e.what();
     } catch (exception e) { 
@@ -62,12 +77,180 @@ string countDistance_double(double (*metricFun)(const TreeTemplate<Node>&, const
     return ss.str(); 
 }
 
-void print(int i, string result, ofstream& ofs)
+void print(size_t i, string result, ofstream& ofs)
 {
    // cout << endl << i << "\t"<< result;
     ofs << endl << i << "\t"<< result;    
 }
 
+/*** The multi-threaded matrix mode ***/ 
+
+/**
+ * A rectangular block of the distance matrix: rows [rowBegin, rowEnd) x columns [colBegin, colEnd).
+ * Only the pairs with row < column are counted.
+ */
+struct MatrixTile
+{
+    int rowBegin, rowEnd;
+    int colBegin, colEnd;
+};
+
+/**
+ * Tiles owned by one worker. The owner takes tiles from the back,
+ * the workers that run out of their own tiles steal from the front.
+ */
+struct TileQueue
+{
+    deque<MatrixTile> tiles;
+    pthread_mutex_t lock;
+};
+
+struct MatrixJob
+{
+    vector<PreparedTree *> *trees;
+    int (*metricFun_int)(const PreparedTree&, const PreparedTree&, bool);
+    int64_t (*metricFun_int64)(const PreparedTree&, const PreparedTree&, bool);
+    double (*metricFun_double)(const PreparedTree&, const PreparedTree&, bool);
+    int doubleRes;
+    int int64Res;
+    bool checkConstraints;
+    // The rows [bandBegin, bandEnd) of the upper triangle, row by row - the order in which the serial mode prints the results
+    int bandBegin, bandEnd;
+    vector<size_t> rowOffsets;
+    vector<string> results;
+    TileQueue *queues;
+    int threadsNum;
+};
+
+struct MatrixWorker
+{
+    MatrixJob *job;
+    int id;
+};
+
+bool takeTile(MatrixJob *job, int workerId, MatrixTile& tile)
+{
+    for (int v = 0; v < job->threadsNum; v++) {
+        TileQueue& q = job->queues[(workerId + v) % job->threadsNum];
+        pthread_mutex_lock(&q.lock);
+        bool found = !q.tiles.empty();
+        if (found) {
+            if (v == 0) {
+                tile = q.tiles.back();
+                q.tiles.pop_back();
+            } else {
+                tile = q.tiles.front();
+                q.tiles.pop_front();
+            }
+        }
+        pthread_mutex_unlock(&q.lock);
+        if (found) return true;
+    }
+    return false;
+}
+
+void* countMatrixTiles(void *arg)
+{
+    MatrixWorker *worker = (MatrixWorker*) arg;
+    MatrixJob *job = worker->job;
+    vector<PreparedTree *>& trees = *job->trees;
+    MatrixTile tile;
+    while (takeTile(job, worker->id, tile)) {
+        for (int i = tile.rowBegin; i < tile.rowEnd; i++) {
+            for (int j = max(i + 1, tile.colBegin); j < tile.colEnd; j++) {
+                job->results[job->rowOffsets[i - job->bandBegin] + (j - i - 1)] = job->doubleRes
+                    ? countDistance_double(job->metricFun_double, trees[i], trees[j], job->checkConstraints)
+                    : job->int64Res
+                    ? countDistance_int64(job->metricFun_int64, trees[i], trees[j], job->checkConstraints)
+                    : countDistance_int(job->metricFun_int, trees[i], trees[j], job->checkConstraints);
+            }
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Counts the upper triangle of the distance matrix on threadsNum threads.
+ * The triangle is cut into bands of tileSize * threadsNum rows, a band is cut into 
+ * tileSize x tileSize tiles that are dealt round-robin to the workers, 
+ * the idle workers steal the tiles of the busy ones.
+ * Every band is printed before the next one is counted, in the same order as in the serial mode, 
+ * so only the results of one band are kept in memory.
+ */
+void countMatrix_parallel(MatrixJob& job, int tileSize, ofstream& ofs)
+{
+    int size = job.trees->size();
+    int bandSize = tileSize * job.threadsNum;
+    job.queues = new TileQueue[job.threadsNum];
+    for (int t = 0; t < job.threadsNum; t++) {
+        pthread_mutex_init(&job.queues[t].lock, NULL);
+    }
+    vector<pthread_t> threads(job.threadsNum);
+    vector<MatrixWorker> workers(job.threadsNum);
+    size_t k = 0;
+    for (int band = 0; band < size; band += bandSize) {
+        job.bandBegin = band;
+        job.bandEnd = min(band + bandSize, size);
+        job.rowOffsets.assign(job.bandEnd - job.bandBegin + 1, 0);
+        for (int i = job.bandBegin; i < job.bandEnd; i++) {
+            job.rowOffsets[i - job.bandBegin + 1] = job.rowOffsets[i - job.bandBegin] + (size - i - 1);
+        }
+        job.results.assign(job.rowOffsets.back(), "");
+
+        int tilesNum = 0;
+        for (int bi = job.bandBegin; bi < job.bandEnd; bi += tileSize) {
+            for (int bj = bi; bj < size; bj += tileSize) {
+                MatrixTile tile;
+                tile.rowBegin = bi;
+                tile.rowEnd = min(bi + tileSize, job.bandEnd);
+                tile.colBegin = bj;
+                tile.colEnd = min(bj + tileSize, size);
+                job.queues[tilesNum % job.threadsNum].tiles.push_back(tile);
+                tilesNum++;
+            }
+        }
+        for (int t = 0; t < job.threadsNum; t++) {
+            workers[t].job = &job;
+            workers[t].id = t;
+            pthread_create(&threads[t], NULL, countMatrixTiles, &workers[t]);
+        }
+        for (int t = 0; t < job.threadsNum; t++) {
+            pthread_join(threads[t], NULL);
+        }
+
+        for (size_t r = 0; r < job.results.size(); r++) {
+            print(k++, job.results[r], ofs);
+        }
+    }
+    for (int t = 0; t < job.threadsNum; t++) {
+        pthread_mutex_destroy(&job.queues[t].lock);
+    }
+    delete[] job.queues;
+}
+
+/**
+ * Counts the Robinson-Foulds distance matrix with the collection-level HashRF engine.
+ * Returns false if the trees can not be compared that way (e.g. different leaves numbers),
+ * then the matrix has to be counted pair by pair.
+ */
+bool countMatrix_hashRF(vector<PreparedTree *>& trees, ofstream& ofs)
+{
+    try {
+        HashRF hashRF(trees);
+        size_t k = 0;
+        for (size_t i = 0; i < trees.size(); i++) {
+            for (size_t j = i + 1; j < trees.size(); j++) {
+                stringstream ss;
+                ss << hashRF.getDistance(i, j);
+                print(k++, ss.str(), ofs);
+            }
+        }
+    } catch (const bpp::Exception& e) {
+        return false;
+    }
+    return true;
+}
+
 int main(int argc, char** argv) 
 {            
     /*** Getting the commandline arguments ***/ 
@@ -81,12 +264,15 @@ int main(int argc, char** argv)
     int compareMode = 0;
     string modeName = "pairs";
     bool checkConstraints = false;
+    int threadsNum = 1;
         
-    int (*metricFun_int)(const TreeTemplate<Node>& trIn1, const TreeTemplate<Node>& trIn2, bool setLeavesId, bool checkNames) 
+    int (*metricFun_int)(const PreparedTree& trIn1, const PreparedTree& trIn2, bool checkNames) 
         = PhylotreeDist::robinsonFoulds;        
-    double (*metricFun_double)(const TreeTemplate<Node>& trIn1, const TreeTemplate<Node>& trIn2, bool setLeavesId, bool checkNames);
+    int64_t (*metricFun_int64)(const PreparedTree& trIn1, const PreparedTree& trIn2, bool checkNames) = NULL;
+    double (*metricFun_double)(const PreparedTree& trIn1, const PreparedTree& trIn2, bool checkNames) = NULL;
     string metricName = "Robinson-Foulds";    
     int doubleRes = 0;
+    int int64Res = 0;
     
     string info = "********************************\n"
                   "         PhylotreeDist\n"
@@ -116,10 +302,22 @@ int main(int argc, char** argv)
             "\t\tnpw - pythagorean metric with branch weights (unrooted, branch-weighted trees)\n"
             "-c  check trees constraints (un/rooted, bi/multifurcating,\n"
             "    the same leaves sets) and throw exception if\n"
-            "    anything is incorrect."
+            "    anything is incorrect.\n"
+            "-t N  number of threads (defaults to 1). In the matrix mode the pairs of trees\n"
+            "    are divided among them, in the pair mode they search the bids of the auction solver (-s a)\n"
+            "    and count the arbitrary degree quartet distance.\n"
+            "-s [auto|jv|h|a]  the matching solver used by the matching distances\n"
+            "\tauto - chosen by the library, currently Jonker-Volgenant (default)\n"
+            "\tjv - Jonker-Volgenant\n"
+            "\th  - Hungarian\n"
+            "\ta  - auction\n"
+            "-q [auto|ad|hd]  the quartet and triplets distances algorithm\n"
+            "\tauto - hierarchical decomposition for bifurcating trees, arbitrary degree otherwise (default)\n"
+            "\tad - arbitrary degree, O(n^2) and more\n"
+            "\thd - hierarchical decomposition, O(n log^2 n) (binary trees)"
             "\n";
     
-    while ((opt = getopt(argc, argv, "i:o:m:d:c")) != -1) {
+    while ((opt = getopt(argc, argv, "i:o:m:d:ct:s:q:")) != -1) {
         switch (opt) {
             case 'i':
                 inFile = optarg; break;
@@ -141,8 +339,8 @@ int main(int argc, char** argv)
                 else if (strncmp(optarg, "mp", 3) == 0) { metricFun_int = PhylotreeDist::perfectMatching_pairs; metricName = "Matching-Pairs"; }
                 else if (strncmp(optarg, "rf", 3) == 0) { metricFun_int = PhylotreeDist::robinsonFoulds; metricName = "Robinson-Foulds"; }
                 else if (strncmp(optarg, "rfw", 4) == 0) { doubleRes = 1; metricFun_double = PhylotreeDist::robinsonFouldsW; metricName = "Robinson-Foulds branch weighted"; }
-                else if (strncmp(optarg, "q", 3) == 0) { metricFun_int = PhylotreeDist::quartetDistance; metricName = "Quartets"; }
-                else if (strncmp(optarg, "t", 3) == 0) { metricFun_int = PhylotreeDist::tripletsDistance; metricName = "Triplets"; }
+                else if (strncmp(optarg, "q", 3) == 0) { int64Res = 1; metricFun_int64 = PhylotreeDist::quartetDistance; metricName = "Quartets"; }
+                else if (strncmp(optarg, "t", 3) == 0) { int64Res = 1; metricFun_int64 = PhylotreeDist::tripletsDistance; metricName = "Triplets"; }
                 else if (strncmp(optarg, "npw", 4) == 0) { doubleRes = 1; metricFun_double = PhylotreeDist::nodalDistanceW_pythagorean; metricName = "Nodal-Pythagorean branch weighted"; }
                 else if (strncmp(optarg, "np", 3) == 0) { doubleRes = 1; metricFun_double = PhylotreeDist::nodalDistance_pythagorean; metricName = "Nodal-Pythagorean"; }
                 else if (strncmp(optarg, "nw", 3) == 0 || strncmp(optarg, "nmw", 4) == 0) {  doubleRes = 1; metricFun_double =  PhylotreeDist::nodalDistanceW;  metricName = "Nodal-Manhattan branch weighted"; } // default for nodal: manhattan
@@ -155,6 +353,38 @@ int main(int argc, char** argv)
             case 'c':
                 checkConstraints = true;
                 break;
+            case 't':
+                threadsNum = atoi(optarg);
+                if (threadsNum < 1) {
+                    cout << "Wrong number of threads (-t). The program will terminate.\n" << info; 
+                    return 0;
+                }
+                break;
+            case 's':
+                if (strncmp(optarg, "auto", 5) == 0) PhylotreeDist::setMatchingAlgorithm(PhylotreeDist::AUTO_SELECTION);
+                else if (strncmp(optarg, "jv", 3) == 0) PhylotreeDist::setMatchingAlgorithm(PhylotreeDist::JONKER_VOLGENANT);
+                else if (strncmp(optarg, "h", 2) == 0) PhylotreeDist::setMatchingAlgorithm(PhylotreeDist::HUNGARIAN_ALGORITHM);
+                else if (strncmp(optarg, "a", 2) == 0) PhylotreeDist::setMatchingAlgorithm(PhylotreeDist::AUCTION_ALGORITHM);
+                else {
+                    cout << "Wrong matching solver (-s). The program will terminate.\n" << info; 
+                    return 0;
+                }
+                break;
+            case 'q':
+                if (strncmp(optarg, "auto", 5) == 0) {
+                    PhylotreeDist::setQuartetAlgorithm(PhylotreeDist::QUARTET_AUTO_SELECTION);
+                    PhylotreeDist::setTripletAlgorithm(PhylotreeDist::TRIPLET_AUTO_SELECTION);
+                } else if (strncmp(optarg, "ad", 3) == 0) {
+                    PhylotreeDist::setQuartetAlgorithm(PhylotreeDist::QUARTET_ARBITRARY_DEGREE);
+                    PhylotreeDist::setTripletAlgorithm(PhylotreeDist::TRIPLET_ARBITRARY_DEGREE);
+                } else if (strncmp(optarg, "hd", 3) == 0) {
+                    PhylotreeDist::setQuartetAlgorithm(PhylotreeDist::QUARTET_HIERARCHICAL_DECOMPOSITION);
+                    PhylotreeDist::setTripletAlgorithm(PhylotreeDist::TRIPLET_HIERARCHICAL_DECOMPOSITION);
+                } else {
+                    cout << "Wrong quartet and triplets algorithm (-q). The program will terminate.\n" << info; 
+                    return 0;
+                }
+                break;
             default:
                 cout << info;                        
         }
@@ -174,10 +404,16 @@ int main(int argc, char** argv)
     cout << message.str();
     ofs << message.str();
     
+    // A single comparison can use the threads only in the auction solver and the quartet distance
+    if (compareMode == 0) {
+        AuctionSolver::setThreadsNumber(threadsNum);
+        QuartetDistance::setThreadsNumber(threadsNum);
+    }
+
     /*** Reading the trees ***/ 
     cout << "Scanning input file... " << flush;
     vector<TreeTemplate<Node> *> treesIn;
-    vector<TreeTemplate<Node> *> trees;
+    vector<PreparedTree *> trees;
     Newick newickReader(false);    
     try {
         newickReader.read(inFile, (vector<Tree *>&) (treesIn));
@@ -189,7 +425,7 @@ int main(int argc, char** argv)
     
     trees.resize(treesIn.size());    
     for (int i = 0; i < treesIn.size(); i++) {
-            trees[i] = tools::TreesManip::createOrderedTrees(*treesIn[i]);
+            trees[i] = new PreparedTree(*treesIn[i]);
             delete treesIn[i];
     }    
     
@@ -197,8 +433,24 @@ int main(int argc, char** argv)
     cout << "Counting the distances: PROCESSING: "; 
     int totalTime = 0;
     totalTime = clock();
+    // Without constraints checking the whole R-F matrix is counted at once
+    bool useHashRF = compareMode == 1 && metricName == "Robinson-Foulds" && !checkConstraints;
+    if (useHashRF && countMatrix_hashRF(trees, ofs)) {
+        cout << ((trees.size() * (trees.size() -1)) / 2)  << " calculations";
+    } else if (compareMode == 1 && threadsNum > 1) {
+        cout << ((trees.size() * (trees.size() -1)) / 2)  << " calculations on " << threadsNum << " threads";
+        MatrixJob job;
+        job.trees = &trees;
+        job.metricFun_int = metricFun_int;
+        job.metricFun_int64 = metricFun_int64;
+        job.metricFun_double = metricFun_double;
+        job.doubleRes = doubleRes;
+        job.int64Res = int64Res;
+        job.checkConstraints = checkConstraints;
+        job.threadsNum = threadsNum;
+        countMatrix_parallel(job, 16, ofs);
     // The Nodal metric has different signature
-    if (doubleRes) {
+    } else if (doubleRes) {
         if (compareMode == 0) {
             cout << trees.size() -1 << "calculations";
             for (int i = 1; i < trees.size(); i++) {
@@ -213,6 +465,22 @@ int main(int argc, char** argv)
                 }
             }
         }    
+    // The quartets and triplets numbers do not fit int
+    } else if (int64Res) {
+        if (compareMode == 0) {
+            cout << trees.size() -1 << " calculations";
+            for (int i = 1; i < trees.size(); i++) {
+                print(i, countDistance_int64(metricFun_int64, trees[i - 1], trees[i], checkConstraints), ofs);
+            }
+        } else if (compareMode == 1) {
+            cout << ((trees.size() * (trees.size() -1)) / 2)  << " calculations";
+            int k = 0;
+            for (int i = 0; i < trees.size(); i++) {
+                for (int j = i + 1; j < trees.size(); j++) {
+                    print(k++, countDistance_int64(metricFun_int64, trees[i], trees[j], checkConstraints), ofs);
+                }
+            }
+        }
     // All the rest metrics have the same signature - they are caled through a delegate    
     } else {    
         if (compareMode == 0) {
@@ -0,0 +1,322 @@
+//
+// File: BitCounting.cpp
+// Created by: agent
+// Created on: 17 October 2026
+//
+
+/*
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "BitCounting.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BITCOUNTING_X86
+#include <immintrin.h>
+// Compilers that know the AVX-512 VPOPCNTDQ intrinsics
+#if (defined(__clang__) && __clang_major__ >= 6) || (!defined(__clang__) && __GNUC__ >= 8)
+#define BITCOUNTING_AVX512
+#endif
+#endif
+
+// The number of rows of bitsA processed together by the cost matrix kernels
+#define TILE_ROWS 4
+
+namespace tools {
+
+static int xorCount_generic(const uint64_t* bitsA, const uint64_t* bitsB, int wordsNum)
+{
+    int count = 0;
+    for (int i = 0; i < wordsNum; i++) {
+        count += BitCounting::countSetBits(bitsA[i] ^ bitsB[i]);
+    }
+    return count;
+}
+
+static inline int toCost(int x, int maxValue)
+{
+    return (x < maxValue - x) ? x : maxValue - x;
+}
+
+static void xorCostMatrix_generic(const uint64_t* bitsA, int rowsNum, const uint64_t* bitsB, int colsNum,
+                                  int wordsNum, int maxValue, int** costs)
+{
+    for (int r = 0; r < rowsNum; r++) {
+        for (int c = 0; c < colsNum; c++) {
+            costs[r][c] = toCost(xorCount_generic(bitsA + r * wordsNum, bitsB + c * wordsNum, wordsNum), maxValue);
+        }
+    }
+}
+
+#ifdef BITCOUNTING_X86
+__attribute__((target("popcnt")))
+static int xorCount_popcnt(const uint64_t* bitsA, const uint64_t* bitsB, int wordsNum)
+{
+    int count = 0;
+    for (int i = 0; i < wordsNum; i++) {
+        count += __builtin_popcountll(bitsA[i] ^ bitsB[i]);
+    }
+    return count;
+}
+
+/*
+ * The bits of each 4 words are counted by looking up the values of their nibbles
+ * in a 16-elements table (W. Mula, N. Kurz, D. Lemire, "Faster Population Counts
+ * Using AVX2 Instructions", 2016).
+ */
+__attribute__((target("avx2,popcnt")))
+static int xorCount_avx2(const uint64_t* bitsA, const uint64_t* bitsB, int wordsNum)
+{
+    int i = 0;
+    int count = 0;
+    if (wordsNum >= 8) {
+        const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                                0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+        const __m256i lowMask = _mm256_set1_epi8(0x0f);
+        __m256i acc = _mm256_setzero_si256();
+        for (; i + 4 <= wordsNum; i += 4) {
+            __m256i v = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(bitsA + i)),
+                                         _mm256_loadu_si256((const __m256i*)(bitsB + i)));
+            __m256i lo = _mm256_and_si256(v, lowMask);
+            __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), lowMask);
+            __m256i cnt = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo), _mm256_shuffle_epi8(lookup, hi));
+            acc = _mm256_add_epi64(acc, _mm256_sad_epu8(cnt, _mm256_setzero_si256()));
+        }
+        count = _mm256_extract_epi64(acc, 0) + _mm256_extract_epi64(acc, 1)
+                + _mm256_extract_epi64(acc, 2) + _mm256_extract_epi64(acc, 3);
+    }
+    for (; i < wordsNum; i++) {
+        count += __builtin_popcountll(bitsA[i] ^ bitsB[i]);
+    }
+    return count;
+}
+
+__attribute__((target("popcnt")))
+static void xorCostMatrix_popcnt(const uint64_t* bitsA, int rowsNum, const uint64_t* bitsB, int colsNum,
+                                 int wordsNum, int maxValue, int** costs)
+{
+    int r = 0;
+    for (; r + TILE_ROWS <= rowsNum; r += TILE_ROWS) {
+        const uint64_t* a0 = bitsA + r * wordsNum;
+        const uint64_t* a1 = a0 + wordsNum;
+        const uint64_t* a2 = a1 + wordsNum;
+        const uint64_t* a3 = a2 + wordsNum;
+        for (int c = 0; c < colsNum; c++) {
+            const uint64_t* b = bitsB + c * wordsNum;
+            int x0 = 0, x1 = 0, x2 = 0, x3 = 0;
+            for (int w = 0; w < wordsNum; w++) {
+                uint64_t bw = b[w];
+                x0 += __builtin_popcountll(a0[w] ^ bw);
+                x1 += __builtin_popcountll(a1[w] ^ bw);
+                x2 += __builtin_popcountll(a2[w] ^ bw);
+                x3 += __builtin_popcountll(a3[w] ^ bw);
+            }
+            costs[r][c] = toCost(x0, maxValue);
+            costs[r + 1][c] = toCost(x1, maxValue);
+            costs[r + 2][c] = toCost(x2, maxValue);
+            costs[r + 3][c] = toCost(x3, maxValue);
+        }
+    }
+    for (; r < rowsNum; r++) {
+        for (int c = 0; c < colsNum; c++) {
+            costs[r][c] = toCost(xorCount_popcnt(bitsA + r * wordsNum, bitsB + c * wordsNum, wordsNum), maxValue);
+        }
+    }
+}
+
+__attribute__((target("avx2,popcnt")))
+static inline __m256i countBytesBits_avx2(__m256i v)
+{
+    const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i lowMask = _mm256_set1_epi8(0x0f);
+    __m256i lo = _mm256_and_si256(v, lowMask);
+    __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), lowMask);
+    __m256i cnt = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo), _mm256_shuffle_epi8(lookup, hi));
+    return _mm256_sad_epu8(cnt, _mm256_setzero_si256());
+}
+
+__attribute__((target("avx2,popcnt")))
+static inline int sumWords_avx2(__m256i acc)
+{
+    return _mm256_extract_epi64(acc, 0) + _mm256_extract_epi64(acc, 1)
+            + _mm256_extract_epi64(acc, 2) + _mm256_extract_epi64(acc, 3);
+}
+
+__attribute__((target("avx2,popcnt")))
+static void xorCostMatrix_avx2(const uint64_t* bitsA, int rowsNum, const uint64_t* bitsB, int colsNum,
+                               int wordsNum, int maxValue, int** costs)
+{
+    if (wordsNum < 4) {
+        xorCostMatrix_popcnt(bitsA, rowsNum, bitsB, colsNum, wordsNum, maxValue, costs);
+        return;
+    }
+    int vectorWords = wordsNum - wordsNum % 4;
+    int r = 0;
+    for (; r + TILE_ROWS <= rowsNum; r += TILE_ROWS) {
+        const uint64_t* a0 = bitsA + r * wordsNum;
+        const uint64_t* a1 = a0 + wordsNum;
+        const uint64_t* a2 = a1 + wordsNum;
+        const uint64_t* a3 = a2 + wordsNum;
+        for (int c = 0; c < colsNum; c++) {
+            const uint64_t* b = bitsB + c * wordsNum;
+            __m256i acc0 = _mm256_setzero_si256();
+            __m256i acc1 = _mm256_setzero_si256();
+            __m256i acc2 = _mm256_setzero_si256();
+            __m256i acc3 = _mm256_setzero_si256();
+            for (int w = 0; w < vectorWords; w += 4) {
+                __m256i vb = _mm256_loadu_si256((const __m256i*)(b + w));
+                acc0 = _mm256_add_epi64(acc0, countBytesBits_avx2(_mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(a0 + w)), vb)));
+                acc1 = _mm256_add_epi64(acc1, countBytesBits_avx2(_mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(a1 + w)), vb)));
+                acc2 = _mm256_add_epi64(acc2, countBytesBits_avx2(_mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(a2 + w)), vb)));
+                acc3 = _mm256_add_epi64(acc3, countBytesBits_avx2(_mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(a3 + w)), vb)));
+            }
+            int x0 = sumWords_avx2(acc0), x1 = sumWords_avx2(acc1), x2 = sumWords_avx2(acc2), x3 = sumWords_avx2(acc3);
+            for (int w = vectorWords; w < wordsNum; w++) {
+                uint64_t bw = b[w];
+                x0 += __builtin_popcountll(a0[w] ^ bw);
+                x1 += __builtin_popcountll(a1[w] ^ bw);
+                x2 += __builtin_popcountll(a2[w] ^ bw);
+                x3 += __builtin_popcountll(a3[w] ^ bw);
+            }
+            costs[r][c] = toCost(x0, maxValue);
+            costs[r + 1][c] = toCost(x1, maxValue);
+            costs[r + 2][c] = toCost(x2, maxValue);
+            costs[r + 3][c] = toCost(x3, maxValue);
+        }
+    }
+    for (; r < rowsNum; r++) {
+        for (int c = 0; c < colsNum; c++) {
+            costs[r][c] = toCost(xorCount_avx2(bitsA + r * wordsNum, bitsB + c * wordsNum, wordsNum), maxValue);
+        }
+    }
+}
+
+#ifdef BITCOUNTING_AVX512
+/*
+ * Unlike _mm512_reduce_add_epi64, the zeroing extracts do not pass an undefined vector to the masked ones.
+ */
+__attribute__((target("avx512f,popcnt")))
+static inline int sumWords_avx512(__m512i acc)
+{
+    return sumWords_avx2(_mm256_add_epi64(_mm512_maskz_extracti64x4_epi64((__mmask8)0xF, acc, 0),
+                                          _mm512_maskz_extracti64x4_epi64((__mmask8)0xF, acc, 1)));
+}
+
+__attribute__((target("avx512f,avx512vpopcntdq,popcnt")))
+static void xorCostMatrix_avx512(const uint64_t* bitsA, int rowsNum, const uint64_t* bitsB, int colsNum,
+                                 int wordsNum, int maxValue, int** costs)
+{
+    if (wordsNum < 4) {
+        xorCostMatrix_popcnt(bitsA, rowsNum, bitsB, colsNum, wordsNum, maxValue, costs);
+        return;
+    }
+    // The last, incomplete vector of 8 words is loaded with a mask
+    __mmask8 tailMask = (__mmask8)((1u << (wordsNum % 8)) - 1);
+    int vectorWords = wordsNum - wordsNum % 8;
+    int r = 0;
+    for (; r + TILE_ROWS <= rowsNum; r += TILE_ROWS) {
+        const uint64_t* a0 = bitsA + r * wordsNum;
+        const uint64_t* a1 = a0 + wordsNum;
+        const uint64_t* a2 = a1 + wordsNum;
+        const uint64_t* a3 = a2 + wordsNum;
+        for (int c = 0; c < colsNum; c++) {
+            const uint64_t* b = bitsB + c * wordsNum;
+            __m512i acc0 = _mm512_setzero_si512();
+            __m512i acc1 = _mm512_setzero_si512();
+            __m512i acc2 = _mm512_setzero_si512();
+            __m512i acc3 = _mm512_setzero_si512();
+            for (int w = 0; w < vectorWords; w += 8) {
+                __m512i vb = _mm512_loadu_si512(b + w);
+                acc0 = _mm512_add_epi64(acc0, _mm512_popcnt_epi64(_mm512_xor_si512(_mm512_loadu_si512(a0 + w), vb)));
+                acc1 = _mm512_add_epi64(acc1, _mm512_popcnt_epi64(_mm512_xor_si512(_mm512_loadu_si512(a1 + w), vb)));
+                acc2 = _mm512_add_epi64(acc2, _mm512_popcnt_epi64(_mm512_xor_si512(_mm512_loadu_si512(a2 + w), vb)));
+                acc3 = _mm512_add_epi64(acc3, _mm512_popcnt_epi64(_mm512_xor_si512(_mm512_loadu_si512(a3 + w), vb)));
+            }
+            if (tailMask != 0) {
+                int w = vectorWords;
+                __m512i vb = _mm512_maskz_loadu_epi64(tailMask, b + w);
+                acc0 = _mm512_add_epi64(acc0, _mm512_popcnt_epi64(_mm512_xor_si512(_mm512_maskz_loadu_epi64(tailMask, a0 + w), vb)));
+                acc1 = _mm512_add_epi64(acc1, _mm512_popcnt_epi64(_mm512_xor_si512(_mm512_maskz_loadu_epi64(tailMask, a1 + w), vb)));
+                acc2 = _mm512_add_epi64(acc2, _mm512_popcnt_epi64(_mm512_xor_si512(_mm512_maskz_loadu_epi64(tailMask, a2 + w), vb)));
+                acc3 = _mm512_add_epi64(acc3, _mm512_popcnt_epi64(_mm512_xor_si512(_mm512_maskz_loadu_epi64(tailMask, a3 + w), vb)));
+            }
+            costs[r][c] = toCost(sumWords_avx512(acc0), maxValue);
+            costs[r + 1][c] = toCost(sumWords_avx512(acc1), maxValue);
+            costs[r + 2][c] = toCost(sumWords_avx512(acc2), maxValue);
+            costs[r + 3][c] = toCost(sumWords_avx512(acc3), maxValue);
+        }
+    }
+    for (; r < rowsNum; r++) {
+        for (int c = 0; c < colsNum; c++) {
+            costs[r][c] = toCost(xorCount_popcnt(bitsA + r * wordsNum, bitsB + c * wordsNum, wordsNum), maxValue);
+        }
+    }
+}
+#endif
+#endif
+
+BitCounting::xorCountFunType BitCounting::xorCountFun = BitCounting::chooseXorCountFun();
+
+BitCounting::xorCountFunType BitCounting::chooseXorCountFun()
+{
+#ifdef BITCOUNTING_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) return xorCount_avx2;
+    if (__builtin_cpu_supports("popcnt")) return xorCount_popcnt;
+#endif
+    return xorCount_generic;
+}
+
+BitCounting::xorCostMatrixFunType BitCounting::xorCostMatrixFun = BitCounting::chooseXorCostMatrixFun();
+
+BitCounting::xorCostMatrixFunType BitCounting::chooseXorCostMatrixFun()
+{
+#ifdef BITCOUNTING_X86
+    __builtin_cpu_init();
+#ifdef BITCOUNTING_AVX512
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vpopcntdq")
+            && __builtin_cpu_supports("popcnt")) return xorCostMatrix_avx512;
+#endif
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) return xorCostMatrix_avx2;
+    if (__builtin_cpu_supports("popcnt")) return xorCostMatrix_popcnt;
+#endif
+    return xorCostMatrix_generic;
+}
+
+const char* BitCounting::getImplementationName()
+{
+#ifdef BITCOUNTING_X86
+#ifdef BITCOUNTING_AVX512
+    if (xorCostMatrixFun == xorCostMatrix_avx512) return "avx512";
+#endif
+    if (xorCostMatrixFun == xorCostMatrix_avx2) return "avx2";
+    if (xorCostMatrixFun == xorCostMatrix_popcnt) return "popcnt";
+#endif
+    return "generic";
+}
+
+int BitCounting::countSetBits(const uint64_t* bits, int wordsNum)
+{
+    int count = 0;
+    for (int i = 0; i < wordsNum; i++) {
+        count += countSetBits(bits[i]);
+    }
+    return count;
+}
+
+} // end of namespace
@@ -25,71 +25,82 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "ClusterTable.h"
 namespace tools
 {
-ClusterTable::ClusterTable(int leavesSize, PostorderTree& tr)
+ClusterTable::ClusterTable(int leavesSize, const PostorderTree& tr)
 {
     internalNodesNum = 0;
-    for (int i = 0; i < leavesSize; i++) {
-            clusterArray.push_back(new ClusterElement());
-    }
+    weight = 0;
+    clusterArray.resize(leavesSize);
     int postorderLeafPosition = 0;
     int top;
     int bottom;
 
+    const int* nodeId = tr.getNodeIds();
+    const int* subNodesSize = tr.getSubNodesSizes();
+    const double* branchW = tr.getBranchWeights();
     int sizeTr = tr.getNumberOfNodes();
     for (int i = 0; i < sizeTr; i++) {
-        PostorderTree::NodeAgent* agent = tr[i];
-        if (agent->subNodesSize == 0) {
-            clusterArray.at(agent->nodeId)->postorderLeafPos = postorderLeafPosition;
+        if (subNodesSize[i] == 0) {
+            clusterArray[nodeId[i]].postorderLeafPos = postorderLeafPosition;
             top = postorderLeafPosition;
             postorderLeafPosition++;
         } else {
             int loc;			// Location of cluster - the position in cllusterArray
-            int leftLeaf = tr[i - agent->subNodesSize]->nodeId;
-            bottom = clusterArray.at(leftLeaf)->postorderLeafPos;
-            PostorderTree::NodeAgent *agentNext = tr[i + 1];
-            loc = (agentNext->subNodesSize == 0) ? top : bottom;
-            clusterArray.at(loc)->lowestElementPos = bottom;
-            clusterArray.at(loc)->highestElementPos = top;
-            clusterArray.at(loc)->branchW = agent->branchW;
-            weight += clusterArray.at(loc)->branchW;
+            int leftLeaf = nodeId[i - subNodesSize[i]];
+            bottom = clusterArray[leftLeaf].postorderLeafPos;
+            // subNodesSize[sizeTr] belongs to the fake last node
+            loc = (subNodesSize[i + 1] == 0) ? top : bottom;
+            clusterArray[loc].lowestElementPos = bottom;
+            clusterArray[loc].highestElementPos = top;
+            clusterArray[loc].branchW = branchW[i];
+            weight += branchW[i];
             internalNodesNum++;
         }
     }
+    tableWeight = weight;
+    listingStack.resize(sizeTr);
 }
 
 ClusterTable::ClusterTable(const ClusterTable& orig) {
     clusterArray = orig.clusterArray;
+    internalNodesNum = orig.internalNodesNum;
+    weight = orig.weight;
+    tableWeight = orig.tableWeight;
+    listingStack.resize(orig.listingStack.size());
 }
 
 ClusterTable::~ClusterTable()
 {
-    for (vector<ClusterElement*>::iterator it = clusterArray.begin(); it != clusterArray.end(); it++) {
-        delete *it;
-    }
 }
 
-void ClusterTable::removeUncommonElements(PostorderTree& otherTr)
+void ClusterTable::removeUncommonElements(const PostorderTree& otherTr)
 {
     internalNodesNum = 0;
-    stack<ClusterTable::Listing*> otherTrListingStack;
-    for (PostorderTree::const_iterator naIt = otherTr.begin(); naIt != otherTr.end(); naIt++) {
-        PostorderTree::NodeAgent* nAgent = *naIt;
-        if (nAgent->subNodesSize == 0) {	// agent of the leaf node
-            int pos = getPostorderPosForNode(nAgent->nodeId);
-            Listing *leafListing = new Listing(pos, pos, 1, 1);
-            otherTrListingStack.push(leafListing);
-        } else {				// agent of the internal node
-            Listing *clusterListing = new Listing();
-            int subSize = nAgent->subNodesSize;
+    weight = tableWeight;
+    for (vector<ClusterElement>::iterator it = clusterArray.begin(); it != clusterArray.end(); it++) {
+        it->valid = false;
+    }
+    const int* nodeId = otherTr.getNodeIds();
+    const int* subNodesSize = otherTr.getSubNodesSizes();
+    const double* branchW = otherTr.getBranchWeights();
+    int sizeTr = otherTr.getNumberOfNodes();
+    if ((int)listingStack.size() < sizeTr) {
+        listingStack.resize(sizeTr);
+    }
+    int stackSize = 0;
+    for (int i = 0; i < sizeTr; i++) {
+        if (subNodesSize[i] == 0) {	// leaf node
+            int pos = getPostorderPosForNode(nodeId[i]);
+            listingStack[stackSize++] = Listing(pos, pos, 1, 1);
+        } else {				// internal node
+            Listing clusterListing;
+            int subSize = subNodesSize[i];
             do {
-                Listing *childListing = otherTrListingStack.top();
-                clusterListing->updateWithNewElement(childListing);
-                subSize -= childListing->subNodesSize;
-                otherTrListingStack.pop();
-                delete childListing;
+                Listing& childListing = listingStack[--stackSize];
+                clusterListing.updateWithNewElement(&childListing);
+                subSize -= childListing.subNodesSize;
             } while (subSize != 0);
-            clusterListing->branchW = nAgent->branchW;
-            otherTrListingStack.push(clusterListing);
+            clusterListing.branchW = branchW[i];
+            listingStack[stackSize++] = clusterListing;
 
             /* Here the clusterListing element (element that describes a cluster 
              * from the otherTr tree) is checked whether it exists in
@@ -111,14 +122,14 @@ void ClusterTable::removeUncommonElements(PostorderTree& otherTr)
              * the lowest (a) or highets (b) postorderLeafPosition of a clusterElement.
 
              */
-            weight += clusterListing->branchW;
-            if (clusterListing->isCompatible()) {
-                int pos = this->getPositionIfContains(clusterListing);
+            weight += clusterListing.branchW;
+            if (clusterListing.isCompatible()) {
+                int pos = this->getPositionIfContains(&clusterListing);
                 if (pos != -1) {
-                    clusterArray[pos]->valid = true;
+                    clusterArray[pos].valid = true;
                     internalNodesNum++;
-                    double w = clusterListing->branchW + clusterArray[pos]->branchW
-                        - abs(clusterListing->branchW - clusterArray[pos]->branchW);
+                    double w = clusterListing.branchW + clusterArray[pos].branchW
+                        - abs(clusterListing.branchW - clusterArray[pos].branchW);
                     weight -= w;
                 }
             }
@@ -128,15 +139,15 @@ void ClusterTable::removeUncommonElements(PostorderTree& otherTr)
 
 int ClusterTable::getPostorderPosForNode(int nodeId)
 {
-    return clusterArray.at(nodeId)->postorderLeafPos;
+    return clusterArray[nodeId].postorderLeafPos;
 }
 
 int ClusterTable::getPositionIfContains(ClusterTable::Listing *listing)
 {
     int l = listing->lowestLeafPos;
     int h = listing->highestLeafPos;
-    if (clusterArray[l]->isElement(l, h)) return l;
-    if (clusterArray[h]->isElement(l, h)) return h;
+    if (clusterArray[l].isElement(l, h)) return l;
+    if (clusterArray[h].isElement(l, h)) return h;
     return -1;
 }
 
@@ -0,0 +1,231 @@
+//
+// File: HashRF.cpp
+// Created by: agent
+// Created on: 17 October 2026
+//
+
+/*
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "HashRF.h"
+#include <new>
+namespace dist {
+
+/*
+ * SplitMix64 generator of the leaves' keys.
+ */
+static uint64_t nextRandom(uint64_t& state)
+{
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+HashRF::HashRF(const vector<PreparedTree*>& trees, unsigned int seed)
+        throw (bpp::Exception)
+{
+    if (trees.empty()) {
+        init(0, 0, false, seed);
+        return;
+    }
+    init(trees.size(), trees[0]->getNumberOfLeaves(), trees[0]->isRooted(), seed);
+    for (vector<PreparedTree*>::const_iterator it = trees.begin(); it != trees.end(); it++) {
+        checkTree((*it)->getTree());
+        addTree((*it)->getPostorderTree());
+    }
+    countSharedSplits();
+}
+
+HashRF::HashRF(const vector<TreeTemplate<Node>*>& trees, bool setNodesId, unsigned int seed)
+        throw (bpp::Exception)
+{
+    if (trees.empty()) {
+        init(0, 0, false, seed);
+        return;
+    }
+    init(trees.size(), trees[0]->getNumberOfLeaves(), trees[0]->isRooted(), seed);
+    for (vector<TreeTemplate<Node>*>::const_iterator it = trees.begin(); it != trees.end(); it++) {
+        checkTree(**it);
+        TreeTemplate<Node>* tr = setNodesId ? TreesManip::createOrderedTrees(**it) : (*it)->clone();
+        // Pay attention - changing tree to speed the algorithm
+        if (!rooted) PostorderTree::rootTree(*tr);
+        PostorderTree pTr(tr->getRootNode());
+        delete tr;
+        addTree(pTr);
+    }
+    countSharedSplits();
+}
+
+HashRF::~HashRF()
+{
+}
+
+void HashRF::init(int treesNumIn, int leavesNumIn, bool rootedIn, unsigned int seed)
+        throw (bpp::Exception)
+{
+    treesNum = treesNumIn;
+    leavesNum = leavesNumIn;
+    rooted = rootedIn;
+    uint64_t state = seed;
+    leafKeys1.resize(leavesNum);
+    leafKeys2.resize(leavesNum);
+    for (int i = 0; i < leavesNum; i++) {
+        leafKeys1[i] = nextRandom(state);
+        leafKeys2[i] = nextRandom(state);
+    }
+    // The shared splits numbers are allocated before the trees are hashed, so that a too large collection fails at once
+    int64_t triangleSize = getTriangleSize(treesNum);
+    if (triangleSize > (int64_t)shared.max_size()) {
+        throw Exception("Too many trees for the shared splits matrix.");
+    }
+    // A tree with n leaves has at most n-3 splits (n-2 clusters)
+    size_t expected = (size_t)treesNum * leavesNum;
+    try {
+        shared.assign(triangleSize, 0);
+        splits.reserve(expected / 4 + 16);
+        occurrences.reserve(expected);
+    } catch (const bad_alloc& e) {
+        throw Exception("Too many trees to count the shared splits in memory.");
+    }
+    treeOffsets.reserve(treesNum + 1);
+    treeOffsets.push_back(0);
+    // The positions in the slots are int
+    int slotsNum = 64;
+    while ((size_t)slotsNum < expected / 2 && slotsNum < (1 << 30)) slotsNum *= 2;
+    slots.assign(slotsNum, -1);
+}
+
+void HashRF::checkTree(const TreeTemplate<Node>& tr)
+        throw (bpp::Exception)
+{
+    if (tr.isRooted() ^ rooted) throw Exception("Bad input trees. Both tree must be either rooted or unrooted.");
+    if ((int)tr.getNumberOfLeaves() != leavesNum) throw Exception("Trees have different sets of leaves.\n");
+}
+
+void HashRF::addTree(const PostorderTree& pTr)
+{
+    const int* nodeId = pTr.getNodeIds();
+    const int* subNodesSize = pTr.getSubNodesSizes();
+    int sizeTr = pTr.getNumberOfNodes();
+    if ((int)hashStack.size() < sizeTr) hashStack.resize(sizeTr);
+    int stackSize = 0;
+    for (int i = 0; i < sizeTr; i++) {
+        HashElement element;
+        if (subNodesSize[i] == 0) {     // leaf node
+            element.hash1 = leafKeys1[nodeId[i]];
+            element.hash2 = leafKeys2[nodeId[i]];
+            element.nodesNum = 1;
+        } else {                        // internal node
+            element.hash1 = 0;
+            element.hash2 = 0;
+            element.nodesNum = 1;
+            int subSize = subNodesSize[i];
+            do {
+                const HashElement& child = hashStack[--stackSize];
+                element.hash1 += child.hash1;
+                element.hash2 += child.hash2;
+                element.nodesNum += child.nodesNum;
+                subSize -= child.nodesNum;
+            } while (subSize != 0);
+            // The root's cluster is the whole leaves set
+            if (i != sizeTr - 1) addSplit(element.hash1, element.hash2);
+        }
+        hashStack[stackSize++] = element;
+    }
+    treeOffsets.push_back(occurrences.size());
+}
+
+void HashRF::addSplit(uint64_t hash1, uint64_t hash2)
+{
+    int treeId = treeOffsets.size() - 1;
+    int mask = slots.size() - 1;
+    int slot = hash1 & mask;
+    while (slots[slot] != -1) {
+        SplitEntry& entry = splits[slots[slot]];
+        if (entry.hash1 == hash1 && entry.hash2 == hash2) {
+            // A split repeated in one tree (e.g. under an unary node) is counted once
+            if (entry.lastTreeId != treeId) {
+                entry.lastTreeId = treeId;
+                entry.treesNum++;
+                occurrences.push_back(slots[slot]);
+            }
+            return;
+        }
+        slot = (slot + 1) & mask;
+    }
+    SplitEntry entry;
+    entry.hash1 = hash1;
+    entry.hash2 = hash2;
+    entry.treesNum = 1;
+    entry.lastTreeId = treeId;
+    slots[slot] = splits.size();
+    occurrences.push_back(splits.size());
+    splits.push_back(entry);
+    if (2 * splits.size() > slots.size()) growSlots();
+}
+
+void HashRF::growSlots()
+{
+    slots.assign(2 * slots.size(), -1);
+    int mask = slots.size() - 1;
+    for (int pos = 0; pos < (int)splits.size(); pos++) {
+        int slot = splits[pos].hash1 & mask;
+        while (slots[slot] != -1) slot = (slot + 1) & mask;
+        slots[slot] = pos;
+    }
+}
+
+void HashRF::countSharedSplits()
+{
+    // Lists of the trees containing each split (CSR), sorted by the trees ids
+    vector<size_t> listOffsets(splits.size() + 1, 0);
+    for (int pos = 0; pos < (int)splits.size(); pos++) {
+        listOffsets[pos + 1] = listOffsets[pos] + splits[pos].treesNum;
+    }
+    vector<size_t> fill(listOffsets.begin(), listOffsets.end() - 1);
+    vector<int> treeLists(occurrences.size());
+    for (int t = 0; t < treesNum; t++) {
+        for (size_t k = treeOffsets[t]; k < treeOffsets[t + 1]; k++) {
+            treeLists[fill[occurrences[k]]++] = t;
+        }
+    }
+
+    for (int pos = 0; pos < (int)splits.size(); pos++) {
+        for (size_t a = listOffsets[pos]; a < listOffsets[pos + 1]; a++) {
+            int i = treeLists[a];
+            int64_t rowIndex = getTriangleIndex(i, i + 1, treesNum) - (i + 1);
+            for (size_t b = a + 1; b < listOffsets[pos + 1]; b++) {
+                shared[rowIndex + treeLists[b]]++;
+            }
+        }
+    }
+}
+
+int HashRF::getDistance(int i, int j) const
+{
+    if (i == j) return 0;
+    if (i > j) {
+        int tmp = i;
+        i = j;
+        j = tmp;
+    }
+    return getSplitsNumber(i) + getSplitsNumber(j) - 2 * shared[getTriangleIndex(i, j, treesNum)];
+}
+
+} // end of namespace
@@ -0,0 +1,255 @@
+//
+// File: HierarchicalDecomposition.cpp
+// Created by: agent
+// Created on: 17 October 2026
+//
+
+/*
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "HierarchicalDecomposition.h"
+#include <algorithm>
+using namespace bpp;
+using namespace std;
+
+namespace tools {
+
+HierarchicalDecomposition::~HierarchicalDecomposition()
+{
+}
+
+void HierarchicalDecomposition::init(const TreeTemplate<Node>& tr1In, const TreeTemplate<Node>& tr2In, bool splitRoot2)
+    throw (Exception)
+{
+    lSize = tr1In.getNumberOfLeaves();
+    // the leaves of tr2 index the arrays of size lSize
+    if ((int)tr2In.getNumberOfLeaves() != lSize) {
+        throw Exception("Trees have different numbers of leaves.");
+    }
+    toArrays(tr1In.getRootNode(), false, sons1, leaves1, subTr1);
+    firstLeaf1.assign(leaves1.size(), 0);
+    leavesOrder1.clear();
+    for (int v = 0; v < (int)leaves1.size(); v++) {
+        firstLeaf1[v] = leavesOrder1.size();
+        if (leaves1[v] >= 0) leavesOrder1.push_back(leaves1[v]);
+    }
+
+    // every node of a heavy path of tr2 must have one light son
+    vector<int> sons2, leaves2, subTr2;
+    toArrays(tr2In.getRootNode(), splitRoot2, sons2, leaves2, subTr2);
+    leafComponents.assign(lSize, -1);
+    colours.assign(lSize, 0);
+    rootComponent = buildPath(0, sons2, leaves2, subTr2);
+    // the components are created after their parts
+    for (int c = 0; c < (int)components.size(); c++) {
+        count(c);
+    }
+}
+
+bool HierarchicalDecomposition::isBinary(const TreeTemplate<Node>& tr)
+{
+    vector<const Node*> nodes = tr.getNodes();
+    const Node* root = tr.getRootNode();
+    for (vector<const Node*>::iterator it = nodes.begin(); it != nodes.end(); it++) {
+        int sonsNum = (*it)->getNumberOfSons();
+        if (sonsNum == 0 || sonsNum == 2) continue;
+        if (sonsNum == 3 && *it == root) continue;
+        return false;
+    }
+    return true;
+}
+
+/*
+ * The nodes are numbered in preorder. If splitRoot, the root with 3 sons s1, s2, s3 
+ * is replaced by a root with sons (s1, s2) and s3 - the new node has degree 2 
+ * in the unrooted tree, so it is not a middle node of any quartet.
+ */
+void HierarchicalDecomposition::toArrays(const Node* root, bool splitRoot, vector<int>& sons, vector<int>& leaves, vector<int>& subTr)
+    throw (Exception)
+{
+    sons.clear();
+    leaves.clear();
+    vector<pair<const Node*, int> > stack;     // a node and the slot for its number
+    if (splitRoot && root->getNumberOfSons() == 3) {
+        sons.assign(6, -1);
+        leaves.push_back(-1);
+        leaves.push_back(-1);
+        sons[0] = 1;
+        stack.push_back(make_pair(root->getSon(2), 1));
+        stack.push_back(make_pair(root->getSon(1), 3 + 1));
+        stack.push_back(make_pair(root->getSon(0), 3 + 0));
+    } else {
+        stack.push_back(make_pair(root, -1));
+    }
+    while (!stack.empty()) {
+        const Node* n = stack.back().first;
+        int slot = stack.back().second;
+        stack.pop_back();
+        int v = leaves.size();
+        int sonsNum = n->getNumberOfSons();
+        if (sonsNum == 1 || sonsNum > 3 || (sonsNum == 3 && n != root)) {
+            throw Exception("Multifurcating tree. Trees must be bifurcating.");
+        }
+        leaves.push_back(sonsNum == 0 ? n->getId() : -1);
+        sons.resize(3 * (v + 1), -1);
+        if (slot >= 0) sons[slot] = v;
+        for (int s = sonsNum - 1; s >= 0; s--) {
+            stack.push_back(make_pair(n->getSon(s), 3 * v + s));
+        }
+    }
+    subTr.assign(leaves.size(), 0);
+    for (int v = leaves.size() - 1; v >= 0; v--) {
+        if (leaves[v] >= 0) {
+            subTr[v] = 1;
+        } else for (int s = 0; s < 3 && sons[3 * v + s] >= 0; s++) {
+            subTr[v] += subTr[sons[3 * v + s]];
+        }
+    }
+}
+
+/*** The hierarchical decomposition of tr2 ***/
+
+/*
+ * Returns the component (without a hole) of the subtree of top.
+ */
+int HierarchicalDecomposition::buildPath(int top, const vector<int>& sons2, const vector<int>& leaves2, const vector<int>& subTr2)
+{
+    vector<int> items;
+    vector<int> weightsSum(1, 0);
+    int v = top;
+    while (leaves2[v] < 0) {
+        int heavy = sons2[3 * v], light = sons2[3 * v + 1];
+        if (subTr2[light] > subTr2[heavy]) swap(heavy, light);
+        int lightComp = buildPath(light, sons2, leaves2, subTr2);
+        items.push_back(addComponent(UNIT_COMPONENT, lightComp, -1));
+        weightsSum.push_back(weightsSum.back() + subTr2[light] + 1);
+        v = heavy;
+    }
+    leafComponents[leaves2[v]] = addComponent(LEAF_COMPONENT, -1, -1);
+    items.push_back(leafComponents[leaves2[v]]);
+    weightsSum.push_back(weightsSum.back() + 1);
+    return join(items, weightsSum, 0, items.size());
+}
+
+/*
+ * Joins the consecutive components items[begin..end) of a heavy path, 
+ * the parts are split in the half of their weights.
+ */
+int HierarchicalDecomposition::join(const vector<int>& items, const vector<int>& weightsSum, int begin, int end)
+{
+    if (end - begin == 1) return items[begin];
+    int half = (weightsSum[begin] + weightsSum[end]) / 2;
+    int middle = upper_bound(weightsSum.begin() + begin + 1, weightsSum.begin() + end, half) - weightsSum.begin();
+    middle = max(begin + 1, min(end - 1, middle));
+    int upper = join(items, weightsSum, begin, middle);
+    int lower = join(items, weightsSum, middle, end);
+    return addComponent(COMPRESSED_COMPONENT, upper, lower);
+}
+
+int HierarchicalDecomposition::addComponent(ComponentType type, int left, int right)
+{
+    Component comp;
+    comp.type = type;
+    comp.left = left;
+    comp.right = right;
+    comp.parent = -1;
+    comp.hole = type == UNIT_COMPONENT || (type == COMPRESSED_COMPONENT && components[right].hole);
+    // all the leaves start with colour 0
+    for (int k = 0; k < COLOURS; k++) comp.cnt[k] = 0;
+    if (type == LEAF_COMPONENT) comp.cnt[0] = 1;
+    comp.poly = addPoly(comp.hole);
+    int c = components.size();
+    if (left >= 0) components[left].parent = c;
+    if (right >= 0) components[right].parent = c;
+    components.push_back(comp);
+    return c;
+}
+
+void HierarchicalDecomposition::count(int c)
+{
+    Component& comp = components[c];
+    switch (comp.type) {
+        case LEAF_COMPONENT: break;
+        case UNIT_COMPONENT: countUnit(comp); break;
+        case COMPRESSED_COMPONENT: countCompressed(comp); break;
+    }
+}
+
+void HierarchicalDecomposition::setColour(int leaf, int colour)
+{
+    if (colours[leaf] == colour) return;
+    int c = leafComponents[leaf];
+    components[c].cnt[colours[leaf]]--;
+    components[c].cnt[colour]++;
+    colours[leaf] = colour;
+    for (c = components[c].parent; c >= 0; c = components[c].parent) {
+        count(c);
+    }
+}
+
+/*** Colouring tr1 ***/
+
+void HierarchicalDecomposition::paint(int v, int colour)
+{
+    for (int i = firstLeaf1[v]; i < firstLeaf1[v] + subTr1[v]; i++) {
+        setColour(leavesOrder1[i], colour);
+    }
+}
+
+int HierarchicalDecomposition::getHeavySon(int v)
+{
+    int heavy = sons1[3 * v];
+    for (int s = 1; s < 3 && sons1[3 * v + s] >= 0; s++) {
+        if (subTr1[sons1[3 * v + s]] > subTr1[heavy]) heavy = sons1[3 * v + s];
+    }
+    return heavy;
+}
+
+/*
+ * On enter all the leaves outside the subtree of top have colour 0.
+ * The light sons are processed first, the recursion depth is O(log n).
+ */
+void HierarchicalDecomposition::processPath(int top, bool keep, int64_t& counted)
+{
+    vector<int> path;
+    int v = top;
+    for (; leaves1[v] < 0; v = getHeavySon(v)) {
+        path.push_back(v);
+    }
+    for (int i = 0; i < (int)path.size(); i++) {
+        int heavy = getHeavySon(path[i]);
+        int light = sons1[3 * path[i]] == heavy ? sons1[3 * path[i] + 1] : sons1[3 * path[i]];
+        processPath(light, false, counted);
+    }
+    setColour(leaves1[v], 1);
+    for (int i = path.size() - 1; i >= 0; i--) {
+        int heavy = getHeavySon(path[i]);
+        int light = sons1[3 * path[i]] == heavy ? sons1[3 * path[i] + 1] : sons1[3 * path[i]];
+        paint(light, 2);
+        counted += getCounted();
+        paint(light, 1);
+    }
+    if (!keep) paint(top, 0);
+}
+
+int64_t HierarchicalDecomposition::choose2(int64_t a)
+{
+    return a * (a - 1) / 2;
+}
+
+} // end of namespace
@@ -0,0 +1,89 @@
+//
+// File: LapWorkspace.cpp
+// Created by: agent
+// Created on: 17 October 2026
+//
+
+/*
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <pthread.h>
+#include "LapWorkspace.h"
+namespace tools {
+
+LapWorkspace::LapWorkspace()
+{
+    dim = 0;
+    capacity = 0;
+    resize(1);
+}
+
+LapWorkspace::~LapWorkspace()
+{
+}
+
+void LapWorkspace::resize(int dimIn)
+{
+    if (dimIn > capacity) {
+        capacity = dimIn;
+        costs.resize((size_t)capacity * capacity);
+        costRows.resize(capacity);
+        // One more element for the solvers that use an additional (virtual) column
+        rowsol.resize(capacity + 1);
+        colsol.resize(capacity + 1);
+        u.resize(capacity + 1);
+        v.resize(capacity + 1);
+        freeRows.resize(capacity + 1);
+        collist.resize(capacity + 1);
+        matches.resize(capacity + 1);
+        d.resize(capacity + 1);
+        pred.resize(capacity + 1);
+        prices.resize(capacity + 1);
+    }
+    dim = dimIn;
+    // The rows of a smaller problem are packed with the stride dim
+    for (int i = 0; i < dim; i++) {
+        costRows[i] = &costs[(size_t)i * dim];
+    }
+}
+
+static pthread_key_t workspaceKey;
+static pthread_once_t workspaceKeyOnce = PTHREAD_ONCE_INIT;
+
+static void deleteWorkspace(void* workspace)
+{
+    delete (LapWorkspace*)workspace;
+}
+
+static void createWorkspaceKey()
+{
+    pthread_key_create(&workspaceKey, deleteWorkspace);
+}
+
+LapWorkspace& LapWorkspace::getThreadWorkspace()
+{
+    pthread_once(&workspaceKeyOnce, createWorkspaceKey);
+    LapWorkspace* workspace = (LapWorkspace*)pthread_getspecific(workspaceKey);
+    if (workspace == NULL) {
+        workspace = new LapWorkspace();
+        pthread_setspecific(workspaceKey, workspace);
+    }
+    return *workspace;
+}
+
+} // end of namespace
@@ -0,0 +1,280 @@
+//
+// File: MatchingSolver.cpp
+// Created by: agent
+// Created on: 17 October 2026
+//
+
+/*
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <climits>
+#include <vector>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include "MatchingSolver.h"
+#include "Hungarian.h"
+#include "hungarianJV/lap.h"
+
+namespace tools {
+
+static const JonkerVolgenantSolver jonkerVolgenantSolver;
+static const HungarianSolver hungarianSolver;
+static const AuctionSolver auctionSolver;
+
+const MatchingSolver& MatchingSolver::getJonkerVolgenant()
+{
+    return jonkerVolgenantSolver;
+}
+
+const MatchingSolver& MatchingSolver::getHungarian()
+{
+    return hungarianSolver;
+}
+
+const MatchingSolver& MatchingSolver::getAuction()
+{
+    return auctionSolver;
+}
+
+const MatchingSolver& MatchingSolver::choose(LapWorkspace& workspace)
+{
+    return jonkerVolgenantSolver;
+}
+
+int JonkerVolgenantSolver::solve(LapWorkspace& workspace) const
+{
+    return lap(workspace);
+}
+
+int HungarianSolver::solve(LapWorkspace& workspace) const
+{
+    return Hungarian::MinWPerfectMatchingCost(workspace);
+}
+
+int AuctionSolver::threadsNumber = 1;
+
+int AuctionSolver::getBiddingThreadsNumber()
+{
+    static const long processorsNumber = sysconf(_SC_NPROCESSORS_ONLN);
+    if (processorsNumber >= 1 && threadsNumber > processorsNumber) return (int)processorsNumber;
+    return threadsNumber;
+}
+
+/**
+ * The two smallest values (scaled cost + price) of a part of the bidder's row.
+ */
+struct AuctionSolver::BidSearch
+{
+    long long best;
+    long long second;
+    int bestCol;
+    // Each thread writes its own cache line
+    char padding[64 - 2 * sizeof(long long) - sizeof(int)];
+};
+
+struct AuctionSolver::Bidding
+{
+    LapWorkspace* workspace;
+    long long scale;
+    long long epsilon;
+    int threadsNum;
+    vector<BidSearch> searches;
+    // The row being bid for, published by incrementing bidsNum
+    volatile int bidder;
+    volatile int bidsNum;
+    volatile int searchesDone;
+    volatile bool finished;
+};
+
+struct AuctionSolver::BiddingWorker
+{
+    Bidding* bidding;
+    int id;
+};
+
+int AuctionSolver::solve(LapWorkspace& workspace) const
+{
+    int dim = workspace.getDim();
+    int** costs = workspace.getCostRows();
+    int* rowsol = workspace.getRowSolution();
+    int* colsol = workspace.getColSolution();
+    // With one object there is no second best value to bid against
+    if (dim == 1) {
+        rowsol[0] = colsol[0] = 0;
+        return costs[0][0];
+    }
+
+    Bidding bidding;
+    bidding.workspace = &workspace;
+    bidding.scale = dim + 1;
+    bidding.epsilon = getCostsRange(workspace) * bidding.scale / EPSILON_FACTOR;
+    if (bidding.epsilon < 1) bidding.epsilon = 1;
+    bidding.threadsNum = dim < PARALLEL_MIN_DIMENSION ? 1 : getBiddingThreadsNumber();
+    bidding.searches.resize(bidding.threadsNum);
+    bidding.bidder = -1;
+    bidding.bidsNum = 0;
+    bidding.searchesDone = 0;
+    bidding.finished = false;
+
+    vector<pthread_t> threads(bidding.threadsNum);
+    vector<BiddingWorker> workers(bidding.threadsNum);
+    // The calling thread is the worker 0
+    for (int t = 1; t < bidding.threadsNum; t++) {
+        workers[t].bidding = &bidding;
+        workers[t].id = t;
+        pthread_create(&threads[t], NULL, bid, &workers[t]);
+    }
+
+    long long* prices = workspace.getPrices();
+    for (int j = 0; j < dim; j++) prices[j] = 0;
+    while (true) {
+        runPhase(bidding);
+        if (bidding.epsilon == 1) break;
+        bidding.epsilon /= EPSILON_FACTOR;
+        if (bidding.epsilon < 1) bidding.epsilon = 1;
+    }
+
+    if (bidding.threadsNum > 1) {
+        bidding.finished = true;
+        __sync_fetch_and_add(&bidding.bidsNum, 1);
+        for (int t = 1; t < bidding.threadsNum; t++) {
+            pthread_join(threads[t], NULL);
+        }
+    }
+
+    int cost = 0;
+    for (int i = 0; i < dim; i++) cost += costs[i][rowsol[i]];
+    return cost;
+}
+
+long long AuctionSolver::getCostsRange(LapWorkspace& workspace)
+{
+    int dim = workspace.getDim();
+    int** costs = workspace.getCostRows();
+    int minCost = INT_MAX, maxCost = INT_MIN;
+    for (int i = 0; i < dim; i++) {
+        for (int j = 0; j < dim; j++) {
+            if (costs[i][j] < minCost) minCost = costs[i][j];
+            if (costs[i][j] > maxCost) maxCost = costs[i][j];
+        }
+    }
+    return (long long)maxCost - minCost;
+}
+
+void* AuctionSolver::bid(void* worker)
+{
+    Bidding& bidding = *((BiddingWorker*)worker)->bidding;
+    int id = ((BiddingWorker*)worker)->id;
+    int bidsSeen = 0;
+    while (true) {
+        for (int spins = 0; bidding.bidsNum == bidsSeen; spins++) {
+            if (spins >= SPINS_BEFORE_YIELD) sched_yield();
+        }
+        __sync_synchronize();
+        bidsSeen = bidding.bidsNum;
+        if (bidding.finished) break;
+        searchBid(bidding, id);
+        __sync_fetch_and_add(&bidding.searchesDone, 1);
+    }
+    return NULL;
+}
+
+void AuctionSolver::searchBid(Bidding& bidding, int workerId)
+{
+    LapWorkspace& workspace = *bidding.workspace;
+    int dim = workspace.getDim();
+    const int* row = workspace.getCostRows()[bidding.bidder];
+    const long long* prices = workspace.getPrices();
+    long long scale = bidding.scale;
+
+    int begin = (int)((long long)dim * workerId / bidding.threadsNum);
+    int end = (int)((long long)dim * (workerId + 1) / bidding.threadsNum);
+    // Minimizing: the best object has the smallest scaled cost + price
+    long long best = LLONG_MAX, second = LLONG_MAX;
+    int bestCol = begin;
+    for (int j = begin; j < end; j++) {
+        long long value = row[j] * scale + prices[j];
+        if (value < best) {
+            second = best;
+            best = value;
+            bestCol = j;
+        } else if (value < second) {
+            second = value;
+        }
+    }
+    BidSearch& search = bidding.searches[workerId];
+    search.best = best;
+    search.second = second;
+    search.bestCol = bestCol;
+}
+
+void AuctionSolver::runPhase(Bidding& bidding)
+{
+    LapWorkspace& workspace = *bidding.workspace;
+    int dim = workspace.getDim();
+    int* rowsol = workspace.getRowSolution();
+    int* colsol = workspace.getColSolution();
+    int* freeRows = workspace.getFreeRows();
+    long long* prices = workspace.getPrices();
+
+    int freeNum = dim;
+    for (int i = 0; i < dim; i++) {
+        rowsol[i] = colsol[i] = -1;
+        freeRows[i] = dim - 1 - i;
+    }
+    while (freeNum > 0) {
+        int i = freeRows[--freeNum];
+        bidding.bidder = i;
+        if (bidding.threadsNum > 1) {
+            bidding.searchesDone = 0;
+            __sync_fetch_and_add(&bidding.bidsNum, 1);
+        }
+        searchBid(bidding, 0);
+        if (bidding.threadsNum > 1) {
+            for (int spins = 0; bidding.searchesDone < bidding.threadsNum - 1; spins++) {
+                if (spins >= SPINS_BEFORE_YIELD) sched_yield();
+            }
+            __sync_synchronize();
+        }
+        // Merging the parts in the columns order gives the serial search result
+        BidSearch found = bidding.searches[0];
+        for (int t = 1; t < bidding.threadsNum; t++) {
+            const BidSearch& search = bidding.searches[t];
+            if (search.best < found.best) {
+                found.second = found.best < search.second ? found.best : search.second;
+                found.best = search.best;
+                found.bestCol = search.bestCol;
+            } else if (search.best < found.second) {
+                found.second = search.best;
+            }
+        }
+        int bestCol = found.bestCol;
+        prices[bestCol] += found.second - found.best + bidding.epsilon;
+
+        int outbid = colsol[bestCol];
+        if (outbid >= 0) {
+            rowsol[outbid] = -1;
+            freeRows[freeNum++] = outbid;
+        }
+        colsol[bestCol] = i;
+        rowsol[i] = bestCol;
+    }
+}
+
+} // end of namespace
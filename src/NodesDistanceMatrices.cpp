@@ -23,143 +23,406 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "NodesDistanceMatrices.h"
+#include <cmath>
+#include <stdint.h>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define NODESDIST_X86
+#include <immintrin.h>
+#endif
 
 namespace tools { 
-    
-double INodesDist::getDistance()
-{        
-    int size = tr1NDists.size();
-    double distance = 0;
-    for (int v1 = 0; v1 < size; v1++) {
-        for (int v2 = v1+1; v2 < size; v2++) {
-            double diff = std::abs(tr1NDists[v1][v2] - tr2NDists[v1][v2]);
-            distance += std::pow(diff, k);
+
+// a node on the stack of the tree walk: its index, the next son to visit
+struct LeavesPaths::Visit
+{
+    Node* node;
+    int index;
+    int nextSon;
+};
+
+LeavesPaths::LeavesPaths(const TreeTemplate<Node>& tr, bool weightedIn)
+{
+    leavesNum = tr.getNumberOfLeaves();
+    weighted = weightedIn;
+    int nodesNum = tr.getNumberOfNodes();
+    father.reserve(nodesNum);
+    if (weighted) depth.reserve(nodesNum); else level.reserve(nodesNum);
+    firstLeaf.reserve(nodesNum);
+    endLeaf.resize(nodesNum);
+    leafNode.resize(leavesNum);
+    leavesOrder.reserve(leavesNum);
+
+    Visit rootVisit = { const_cast<Node*> (tr.getRootNode()), 0, 0 };
+    father.push_back(-1);
+    if (weighted) depth.push_back(0); else level.push_back(0);
+    firstLeaf.push_back(0);
+    vector<Visit> stack(1, rootVisit);
+    while (!stack.empty()) {
+        Visit& top = stack.back();
+        if (top.nextSon < (int) top.node->getNumberOfSons()) {
+            Node* son = top.node->getSon(top.nextSon++);
+            Visit sonVisit = { son, (int) father.size(), 0 };
+            father.push_back(top.index);
+            if (weighted) {
+                depth.push_back(depth[top.index] + son->getDistanceToFather());
+            } else {
+                level.push_back(level[top.index] + 1);
+            }
+            firstLeaf.push_back(leavesOrder.size());
+            stack.push_back(sonVisit);
+            continue;
         }
+        if (top.node->isLeaf()) {
+            leafNode[top.node->getId()] = top.index;
+            leavesOrder.push_back(top.node->getId());
+        }
+        endLeaf[top.index] = leavesOrder.size();
+        stack.pop_back();
     }
-    distance = std::pow(distance, 1/(double)k);
-    return distance;        
 }
 
+void LeavesPaths::cacheRows()
+{
+    if (hasCachedRows()) return;
+    size_t size = (size_t) leavesNum * leavesNum;
+    if (weighted) {
+        rows.resize(size);
+        for (int i = 0; i < leavesNum; i++) countRow(i, depth, &rows[(size_t) i * leavesNum]);
+    } else {
+        levelRows.resize(size);
+        for (int i = 0; i < leavesNum; i++) countRow(i, level, &levelRows[(size_t) i * leavesNum]);
+    }
+}
 
+const double* LeavesPaths::getRow(int leafId, double* buffer) const
+{
+    if (!rows.empty()) return &rows[(size_t) leafId * leavesNum];
+    countRow(leafId, depth, buffer);
+    return buffer;
+}
 
-void WeigthedNodesDist::getTreeNodesDists(TreeTemplate<Node>& tr, vector<vector <double> >& trNDists)
+const int* LeavesPaths::getRow(int leafId, int* buffer) const
 {
-    vector<Node*> leaves = tr.getLeaves();
+    if (!levelRows.empty()) return &levelRows[(size_t) leafId * leavesNum];
+    countRow(leafId, level, buffer);
+    return buffer;
+}
 
-    vector <double> tmp;
-    tmp.resize(leaves.size(), 0);
-    trNDists.resize(leaves.size(), tmp);
+template <class Length>
+void LeavesPaths::countRow(int leafId, const vector<Length>& depths, Length* row) const
+{
+    int v = leafNode[leafId];
+    Length leafDepth = depths[v];
+    row[leafId] = 0;
+    // the leaves of the ancestor a which are not under its son v have their lca in a
+    while (father[v] >= 0) {
+        int a = father[v];
+        Length base = leafDepth - 2 * depths[a];
+        for (int p = firstLeaf[a]; p < firstLeaf[v]; p++) {
+            int j = leavesOrder[p];
+            row[j] = base + depths[leafNode[j]];
+        }
+        for (int p = endLeaf[v]; p < endLeaf[a]; p++) {
+            int j = leavesOrder[p];
+            row[j] = base + depths[leafNode[j]];
+        }
+        v = a;
+    }
+}
 
-    vector<int> leavesIdLevel;
-    leavesIdLevel.resize(leaves.size());
-    TreesManip::getLeavesLevels(tr.getRootNode(), 0, leavesIdLevel);
 
-    for (int i = 0; i < leaves.size(); i++) {
-        for (int j = i + 1; j < leaves.size(); j++) {
-            Node* ni = leaves[i];
-            int idi = ni->getId();
-            int li = leavesIdLevel[idi];
-            Node* nj = leaves[j];
-            int idj = nj->getId();
-            int lj = leavesIdLevel[idj];
+/*
+ * The kernels of the nodal sums over a part of two rows, |d|^k for k = 1 and k = 2. 
+ * The int path lengths are summed in 64 bits. The doubles are summed in 4 parts, 
+ * the j-th value to the part j % 4, then (part0 + part1) + (part2 + part3), without FMA - 
+ * the same order in the generic and the AVX2 kernels, so they give the same sums.
+ */
+template <int K> struct NodalTerm;
+template <> struct NodalTerm<1> {
+    template <class Sum> static Sum of(Sum d) { return d < 0 ? -d : d; }
+};
+template <> struct NodalTerm<2> {
+    template <class Sum> static Sum of(Sum d) { return d * d; }
+};
 
-            if (li < lj) {
-                while (li != lj) {
-                    double val = nj->getDistanceToFather();
-                    nj = nj->getFather();
-                    lj--;
-                    trNDists[idi][idj] += val;
-                    trNDists[idj][idi] += val;
-                }
-            } else {
-                while (li != lj) {
-                    double val = nj->getDistanceToFather();
-                    ni = ni->getFather();
-                    li--;
-                    trNDists[idi][idj] += val;
-                    trNDists[idj][idi] += val;         
-                }
-            }
+template <class Length> struct NodalSum;
+template <> struct NodalSum<int> { typedef int64_t Type; };
+template <> struct NodalSum<double> { typedef double Type; };
 
-            while (ni != nj) {
-                double val = nj->getDistanceToFather();
-                val += ni->getDistanceToFather();
-                ni = ni->getFather();
-                nj = nj->getFather();
-                trNDists[idi][idj] += val;
-                trNDists[idj][idi] += val;
-                li--;
-            }
+template <int K, class Length>
+static typename NodalSum<Length>::Type sumRow_generic(const Length* row1, const Length* row2, int begin, int end)
+{
+    typedef typename NodalSum<Length>::Type Sum;
+    const int LANES = 4;
+    Sum part[LANES] = { 0, 0, 0, 0 };
+    int j = begin;
+    for (; j + LANES <= end; j += LANES) {
+        for (int l = 0; l < LANES; l++) {
+            part[l] += NodalTerm<K>::of((Sum) row1[j + l] - (Sum) row2[j + l]);
         }
     }
+    Sum sum = (part[0] + part[1]) + (part[2] + part[3]);
+    for (; j < end; j++) {
+        sum += NodalTerm<K>::of((Sum) row1[j] - (Sum) row2[j]);
+    }
+    return sum;
 }
-WeigthedNodesDist::WeigthedNodesDist(int kIn)
+
+#ifdef NODESDIST_X86
+__attribute__((target("avx2")))
+static inline int64_t sumWords_avx2(__m256i acc)
 {
-    k = kIn;
+    return _mm256_extract_epi64(acc, 0) + _mm256_extract_epi64(acc, 1)
+            + _mm256_extract_epi64(acc, 2) + _mm256_extract_epi64(acc, 3);
 }
-void WeigthedNodesDist::init(const TreeTemplate<Node> &tr1, const TreeTemplate<Node> &tr2)
+
+__attribute__((target("avx2")))
+static int64_t sumLevelsRow1_avx2(const int* row1, const int* row2, int begin, int end)
 {
-    getTreeNodesDists(const_cast<TreeTemplate<Node>& > (tr1), tr1NDists);
-    getTreeNodesDists(const_cast<TreeTemplate<Node>& > (tr2), tr2NDists);
+    __m256i acc = _mm256_setzero_si256();
+    int j = begin;
+    for (; j + 8 <= end; j += 8) {
+        __m256i d = _mm256_abs_epi32(_mm256_sub_epi32(_mm256_loadu_si256((const __m256i*)(row1 + j)),
+                                                      _mm256_loadu_si256((const __m256i*)(row2 + j))));
+        acc = _mm256_add_epi64(acc, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(d)));
+        acc = _mm256_add_epi64(acc, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(d, 1)));
+    }
+    int64_t sum = sumWords_avx2(acc);
+    for (; j < end; j++) {
+        sum += NodalTerm<1>::of((int64_t) row1[j] - row2[j]);
+    }
+    return sum;
 }
 
+__attribute__((target("avx2")))
+static int64_t sumLevelsRow2_avx2(const int* row1, const int* row2, int begin, int end)
+{
+    __m256i acc = _mm256_setzero_si256();
+    int j = begin;
+    for (; j + 8 <= end; j += 8) {
+        __m256i d = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i*)(row1 + j)),
+                                     _mm256_loadu_si256((const __m256i*)(row2 + j)));
+        __m256i lo = _mm256_cvtepi32_epi64(_mm256_castsi256_si128(d));
+        __m256i hi = _mm256_cvtepi32_epi64(_mm256_extracti128_si256(d, 1));
+        acc = _mm256_add_epi64(acc, _mm256_mul_epi32(lo, lo));
+        acc = _mm256_add_epi64(acc, _mm256_mul_epi32(hi, hi));
+    }
+    int64_t sum = sumWords_avx2(acc);
+    for (; j < end; j++) {
+        sum += NodalTerm<2>::of((int64_t) row1[j] - row2[j]);
+    }
+    return sum;
+}
 
+__attribute__((target("avx2")))
+static inline double sumParts_avx2(__m256d acc, int j, int end, const double* row1, const double* row2, bool square)
+{
+    double part[4];
+    _mm256_storeu_pd(part, acc);
+    double sum = (part[0] + part[1]) + (part[2] + part[3]);
+    for (; j < end; j++) {
+        double d = row1[j] - row2[j];
+        sum += square ? d * d : NodalTerm<1>::of(d);
+    }
+    return sum;
+}
 
-void UnWeigthedNodesDist::getTreeNodesDists(TreeTemplate<Node>& tr, vector<vector <double> >& trNDists)
+__attribute__((target("avx2")))
+static double sumLengthsRow1_avx2(const double* row1, const double* row2, int begin, int end)
 {
-    vector<Node*> leaves = tr.getLeaves();
+    const __m256d signMask = _mm256_set1_pd(-0.0);
+    __m256d acc = _mm256_setzero_pd();
+    int j = begin;
+    for (; j + 4 <= end; j += 4) {
+        __m256d d = _mm256_sub_pd(_mm256_loadu_pd(row1 + j), _mm256_loadu_pd(row2 + j));
+        acc = _mm256_add_pd(acc, _mm256_andnot_pd(signMask, d));
+    }
+    return sumParts_avx2(acc, j, end, row1, row2, false);
+}
 
-    vector <double> tmp;
-    tmp.resize(leaves.size(), 0);
-    trNDists.resize(leaves.size(), tmp);    
+__attribute__((target("avx2")))
+static double sumLengthsRow2_avx2(const double* row1, const double* row2, int begin, int end)
+{
+    __m256d acc = _mm256_setzero_pd();
+    int j = begin;
+    for (; j + 4 <= end; j += 4) {
+        __m256d d = _mm256_sub_pd(_mm256_loadu_pd(row1 + j), _mm256_loadu_pd(row2 + j));
+        acc = _mm256_add_pd(acc, _mm256_mul_pd(d, d));
+    }
+    return sumParts_avx2(acc, j, end, row1, row2, true);
+}
+#endif
 
-    vector<int> leavesIdLevel;
-    leavesIdLevel.resize(leaves.size());
-    TreesManip::getLeavesLevels(tr.getRootNode(), 0, leavesIdLevel);
+typedef int64_t (*levelsRowFunType)(const int* row1, const int* row2, int begin, int end);
+typedef double (*lengthsRowFunType)(const double* row1, const double* row2, int begin, int end);
 
-    for (int i = 0; i < leaves.size(); i++) {
-        for (int j = i + 1; j < leaves.size(); j++) {
-            Node* ni = leaves[i];
-            int idi = ni->getId();
-            int li = leavesIdLevel[idi];
-            Node* nj = leaves[j];
-            int idj = nj->getId();
-            int lj = leavesIdLevel[idj];
+// the kernels for k = 1 and k = 2, indexed by k - 1
+struct NodalKernels {
+    levelsRowFunType levels[2];
+    lengthsRowFunType lengths[2];
+};
 
-            if (li < lj) {
-                while (li != lj) {                    
-                    nj = nj->getFather();
-                    lj--;
-                    trNDists[idi][idj]++; 
-                    trNDists[idj][idi]++;                    
-                } 
-            } else {
-                while (li != lj) {
-                    ni = ni->getFather();
-                    li--;
-                    trNDists[idi][idj]++; 
-                    trNDists[idj][idi]++;                        
-                } 
-            }     
-
-            while (ni != nj) {
-                ni = ni->getFather();
-                nj = nj->getFather();
-                trNDists[idi][idj] += 2;
-                trNDists[idj][idi] += 2;     
-                li--;
-            }            
+static const NodalKernels genericNodalKernels = {
+    { sumRow_generic<1, int>, sumRow_generic<2, int> },
+    { sumRow_generic<1, double>, sumRow_generic<2, double> }
+};
+
+static NodalKernels chooseNodalKernels()
+{
+    NodalKernels kernels = genericNodalKernels;
+#ifdef NODESDIST_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        kernels.levels[0] = sumLevelsRow1_avx2;
+        kernels.levels[1] = sumLevelsRow2_avx2;
+        kernels.lengths[0] = sumLengthsRow1_avx2;
+        kernels.lengths[1] = sumLengthsRow2_avx2;
+    }
+#endif
+    return kernels;
+}
+
+static const NodalKernels cpuNodalKernels = chooseNodalKernels();
+static const NodalKernels* nodalKernels = &cpuNodalKernels;
+
+static inline int64_t sumRow(int k, const int* row1, const int* row2, int begin, int end)
+{
+    return nodalKernels->levels[k - 1](row1, row2, begin, end);
+}
+static inline double sumRow(int k, const double* row1, const double* row2, int begin, int end)
+{
+    return nodalKernels->lengths[k - 1](row1, row2, begin, end);
+}
+
+// any other k
+template <class Length>
+static double sumRowPow(const Length* row1, const Length* row2, int begin, int end, int k)
+{
+    double sum = 0;
+    for (int j = begin; j < end; j++) {
+        sum += std::pow(std::abs((double) row1[j] - (double) row2[j]), k);
+    }
+    return sum;
+}
+
+// The sum of the rows sums: exact for the 64-bit integers, compensated (Kahan-Neumaier) for doubles.
+template <class Sum> struct RowsTotal {
+    Sum sum;
+    RowsTotal() : sum(0) {}
+    void add(Sum x) { sum += x; }
+    double get() const { return sum; }
+};
+template <> struct RowsTotal<double> {
+    double sum;
+    double compensation;
+    RowsTotal() : sum(0), compensation(0) {}
+    void add(double x)
+    {
+        double t = sum + x;
+        compensation += std::abs(sum) >= std::abs(x) ? (sum - t) + x : (x - t) + sum;
+        sum = t;
+    }
+    double get() const { return sum + compensation; }
+};
+
+template <class Length>
+static double sumRows(const LeavesPaths& paths1, const LeavesPaths& paths2, int k)
+{
+    int size = paths1.getNumberOfLeaves();
+    vector<Length> buffer1(size), buffer2(size);
+    RowsTotal<typename NodalSum<Length>::Type> total;
+    RowsTotal<double> powTotal;
+    for (int v1 = 0; v1 < size; v1++) {
+        const Length* row1 = paths1.getRow(v1, &buffer1[0]);
+        const Length* row2 = paths2.getRow(v1, &buffer2[0]);
+        if (k == 1 || k == 2) {
+            total.add(sumRow(k, row1, row2, v1 + 1, size));
+        } else {
+            powTotal.add(sumRowPow(row1, row2, v1 + 1, size, k));
         }
     }
+    return (k == 1 || k == 2) ? total.get() : powTotal.get();
+}
+
+
+INodesDist::INodesDist()
+{
+    tr1Paths = NULL;
+    tr2Paths = NULL;
+}
+INodesDist::~INodesDist()
+{
+    delete tr1Paths;
+    delete tr2Paths;
+}
+
+double INodesDist::getDistance()
+{        
+    return getDistance(*tr1Paths, *tr2Paths, k);
+}
+
+double INodesDist::getDistance(const LeavesPaths& paths1, const LeavesPaths& paths2, int k)
+    throw (Exception)
+{        
+    if (paths1.isWeighted() != paths2.isWeighted()) {
+        throw Exception("Nodal distance: the paths of both trees must be weighted or both unweighted.");
+    }
+    double distance = paths1.isWeighted() 
+            ? sumRows<double>(paths1, paths2, k) 
+            : sumRows<int>(paths1, paths2, k);
+    if (k == 1) return distance;
+    if (k == 2) return std::sqrt(distance);
+    return std::pow(distance, 1/(double)k);
+}
+
+const char* INodesDist::getImplementationName()
+{
+#ifdef NODESDIST_X86
+    if (nodalKernels->levels[0] == sumLevelsRow1_avx2) return "avx2";
+#endif
+    return "generic";
+}
+
+void INodesDist::forceGenericImplementation(bool generic)
+{
+    nodalKernels = generic ? &genericNodalKernels : &cpuNodalKernels;
 }
+
+bool INodesDist::isGenericImplementationForced()
+{
+    return nodalKernels == &genericNodalKernels;
+}
+
+void INodesDist::setPaths(const TreeTemplate<Node> &tr1, const TreeTemplate<Node> &tr2, bool weighted)
+{
+    delete tr1Paths;
+    delete tr2Paths;
+    tr1Paths = NULL;
+    tr2Paths = NULL;
+    tr1Paths = new LeavesPaths(tr1, weighted);
+    tr2Paths = new LeavesPaths(tr2, weighted);
+}
+
+
+
+WeigthedNodesDist::WeigthedNodesDist(int kIn)
+{
+    k = kIn;
+}
+void WeigthedNodesDist::init(const TreeTemplate<Node> &tr1, const TreeTemplate<Node> &tr2)
+{
+    setPaths(tr1, tr2, true);
+}
+
+
+
 UnWeigthedNodesDist::UnWeigthedNodesDist(int kIn)
 {
     k = kIn;
 }
 void UnWeigthedNodesDist::init(const TreeTemplate<Node> &tr1, const TreeTemplate<Node> &tr2)
 {
-    getTreeNodesDists(const_cast<TreeTemplate<Node>& > (tr1), tr1NDists);
-    getTreeNodesDists(const_cast<TreeTemplate<Node>& > (tr2), tr2NDists);
+    setPaths(tr1, tr2, false);
 }
 } // end of namespace
-
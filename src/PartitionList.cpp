@@ -23,28 +23,40 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "PartitionList.h"
-#include <string.h>     // strcat
+#include <string.h>     // memset
+#include <stdlib.h>     // posix_memalign
+#include <new>
 
 namespace tools
 {
-const int PartitionList::BITS_IN_INT = 32;
+const int PartitionList::BITS_IN_WORD = 64;
 
-PartitionList::PartitionList() {}        
+PartitionList::PartitionList() 
+{
+    words = NULL;
+    wordsCount = 0;
+    capacity = 0;
+}        
 
 PartitionList::~PartitionList() 
 {
-    for(vector<int*>::iterator it = bitList.begin(); it != bitList.end(); it++) {
-        delete[] *it;
-    }
+    free(words);
 }
 
-PartitionList::PartitionList(int count)
+PartitionList::PartitionList(int count, int capacity)
 {
-    intCount = ceil((float)count / BITS_IN_INT );  
+    wordsCount = (count + BITS_IN_WORD - 1) / BITS_IN_WORD;
+    this->capacity = capacity;
+    words = NULL;
+    size_t bytes = (size_t)wordsCount * capacity * sizeof(uint64_t);
+    if (posix_memalign((void**)&words, 32, bytes > 0 ? bytes : sizeof(uint64_t)) != 0) {
+        throw bad_alloc();
+    }
+    bitList.reserve(capacity);
 }
 
 
-const vector<int *>& PartitionList::getBitList()
+const vector<uint64_t *>& PartitionList::getBitList() const
 {
     return bitList;
 }
@@ -55,52 +67,58 @@ int PartitionList::size() const
 }
 
 
-int* PartitionList::browseTree(Node* root)
+void PartitionList::browseTree(const Node* root)
 {
     browseTree_do(root);
-
-    //clear undeleted clusters
-    for(vector<int*>::iterator it = leavesBitList.begin(); it !=leavesBitList.end(); it++) {
-        delete[] *it;
-    }
-    leavesBitList.clear();
 }
 
-int* PartitionList::browseTree_do(Node* root)
+uint64_t* PartitionList::browseTree_do(const Node* root)
 {
-    int* cluster = new int[intCount];
-    for (int i = 0; i < intCount; i++) cluster[i] = 0;
-    vector<Node*> sons = root->getSons();
-    if (sons.size() == 0) {		// a leaf
-        setLeafBit(root->getId(), cluster);
-        leavesBitList.push_back(cluster);
-    } else {
-        for (vector<Node*>::iterator it = sons.begin(); it != sons.end(); it++) {
-            joinBits(cluster, browseTree_do(*it));
+    int sonsNum = root->getNumberOfSons();
+    if (sonsNum == 0) {		// a leaf, its bit is set in the father's cluster
+        return NULL;
+    }
+    vector<uint64_t*> sonsClusters(sonsNum);
+    for (int i = 0; i < sonsNum; i++) {
+        sonsClusters[i] = browseTree_do(root->getSon(i));
+    }
+    uint64_t* cluster = words + bitList.size() * wordsCount;
+    memset(cluster, 0, wordsCount * sizeof(uint64_t));
+    for (int i = 0; i < sonsNum; i++) {
+        if (sonsClusters[i] == NULL) {
+            setLeafBit(root->getSon(i)->getId(), cluster);
+        } else {
+            joinBits(cluster, sonsClusters[i]);
         }
-        bitList.push_back(cluster);
     }
+    bitList.push_back(cluster);
     return cluster;
 }
 
+void PartitionList::removeLast()
+{
+    bitList.pop_back();
+}
+
 /*
 * This bases on the fact that the trees have the same leaves ids
 */
-void PartitionList::setLeafBit(int leafId, int* clusterBitList)
+void PartitionList::setLeafBit(int leafId, uint64_t* clusterBitList)
 {
-    int listIntPosition = floor((float)leafId / BITS_IN_INT);
-    int listPosition = leafId % BITS_IN_INT;
-    clusterBitList[listIntPosition] = 1 << listPosition;
+    int listWordPosition = leafId / BITS_IN_WORD;
+    int listPosition = leafId % BITS_IN_WORD;
+    clusterBitList[listWordPosition] |= (uint64_t)1 << listPosition;
 }
-void PartitionList::joinBits(int *cl1, const int *cl2)
+void PartitionList::joinBits(uint64_t *cl1, const uint64_t *cl2)
 {
-    for (int i = 0; i < intCount; i++) {
+    for (int i = 0; i < wordsCount; i++) {
         cl1[i] = cl1[i] | cl2[i];
     }
 }
 
 
-ClusterList::ClusterList(const TreeTemplate<Node>& tr) : PartitionList(tr.getNumberOfLeaves())
+ClusterList::ClusterList(const TreeTemplate<Node>& tr) 
+    : PartitionList(tr.getNumberOfLeaves(), tr.getNumberOfNodes() - tr.getNumberOfLeaves())
 {
     //intCount = ceil(43 / BITS_IN_INT );
     Node *root = ((const_cast<TreeTemplate<Node>& >(tr)).getRootNode());
@@ -111,7 +129,8 @@ ClusterList::ClusterList(const TreeTemplate<Node>& tr) : PartitionList(tr.getNum
     }
 }
 
-BipartitionList::BipartitionList(const TreeTemplate<Node>& tr) : PartitionList(tr.getNumberOfLeaves())
+BipartitionList::BipartitionList(const TreeTemplate<Node>& tr) 
+    : PartitionList(tr.getNumberOfLeaves(), tr.getNumberOfNodes() - tr.getNumberOfLeaves())
 {
     //intCount = ceil(43 / BITS_IN_INT );
     Node *root = ((const_cast<TreeTemplate<Node>& >(tr)).getRootNode());
@@ -123,8 +142,7 @@ BipartitionList::BipartitionList(const TreeTemplate<Node>& tr) : PartitionList(t
 
     //remove one of repeated fake-root bipartitions
     if (root->getNumberOfSons() == 2) {
-        delete[] bitList.back();
-        bitList.pop_back();
+        removeLast();
     }
 
 }
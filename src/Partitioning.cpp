@@ -27,25 +27,30 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 namespace tools
 {
-LeavesSets::LeavesList* PairLeavesSets::browseTree(int rootId, const TreeTemplate<Node>& tr, int& rootIndex, vector<vector<int> >& splitNode)
+int PairLeavesSets::browseTree(int rootId, const TreeTemplate<Node>& tr, InternalNodes& nodes, int& leafRank)
 {
     vector<int> sons = tr.getSonsId(rootId);
     if (sons.size() == 0) {			// a leaf
-        return new LeavesList(rootId);		
-    } else {				//2 sons in bifurcating tree
-        LeavesList* l1 = browseTree(sons.at(0), tr, rootIndex, splitNode);
-        LeavesList* l2 = browseTree(sons.at(1), tr, rootIndex, splitNode);
-        for (l1->resetIteration(); !l1->iterationFinished();) {
-            int leafIdTr1 = l1->nextId();
-            for (l2->resetIteration(); !l2->iterationFinished();) {
-                int leafIdTr2 = l2->nextId();
-                splitNode[leafIdTr1][leafIdTr2] = rootIndex;
-                splitNode[leafIdTr2][leafIdTr1] = rootIndex;
-            }
+        nodes.leafRank[rootId] = leafRank++;
+        return -1 - rootId;
+    } else {
+        int firstLeaf = leafRank;
+        for (unsigned int i = 0; i < sons.size(); i++) {
+            sons[i] = browseTree(sons[i], tr, nodes, leafRank);
+        }
+        int subLeavesNum = leafRank - firstLeaf;
+        // The pairs of leaves from two different subtrees
+        int pairsNum = subLeavesNum * subLeavesNum;
+        nodes.sonsBegin.push_back(nodes.sons.size());
+        for (unsigned int i = 0; i < sons.size(); i++) {
+            nodes.sons.push_back(sons[i]);
+            int sonLeavesNum = getSubLeavesNum(nodes, sons[i]);
+            pairsNum -= sonLeavesNum * sonLeavesNum;
         }
-        rootIndex++;
-        l1->concat(l2);
-        return l1;
+        nodes.firstLeaf.push_back(firstLeaf);
+        nodes.subLeavesNum.push_back(subLeavesNum);
+        nodes.pairsNum.push_back(pairsNum / 2);
+        return nodes.size() - 1;
     }
 }
 
@@ -53,51 +58,94 @@ LeavesSets::LeavesList* PairLeavesSets::browseTree(int rootId, const TreeTemplat
 PairLeavesSets::PairLeavesSets(const TreeTemplate<Node> &tr1, const TreeTemplate<Node> &tr2)
 {       
     leavesNum = tr1.getNumberOfLeaves();
-    vector<int> tmp;
-    tmp.assign(leavesNum , 0);
-    splitNode1.assign(leavesNum, tmp);
-    splitNode2.assign(leavesNum, tmp);
-
-    int rootIndex = 0;
-    browseTree(tr1.getRootId(), tr1, rootIndex, splitNode1);
-    rootIndex = 0;
-    browseTree(tr2.getRootId(), tr2, rootIndex, splitNode2);
-    inNodesNum = rootIndex;   // both tree, as thet are bifurcating and have the same leaves sets - have the equal number of internal nodes           
+    nodes1.leafRank.resize(leavesNum);
+    nodes2.leafRank.resize(leavesNum);
+
+    int leafRank = 0;
+    browseTree(tr1.getRootId(), tr1, nodes1, leafRank);
+    nodes1.sonsBegin.push_back(nodes1.sons.size());
+    leafRank = 0;
+    browseTree(tr2.getRootId(), tr2, nodes2, leafRank);
+    nodes2.sonsBegin.push_back(nodes2.sons.size());
+    // In multifurcating trees the numbers of internal nodes may differ, the smaller set gets dummy elements
+    inNodesNum = max(nodes1.size(), nodes2.size());
 }
 int PairLeavesSets::getSize() { return inNodesNum; }
 
-int PairLeavesSets::getCostMatrix(int** costMatrix)
+int PairLeavesSets::getSubLeavesNum(const InternalNodes& nodes, int son) const
+{
+    return son < 0 ? 1 : nodes.subLeavesNum[son];
+}
+
+int PairLeavesSets::getCommonPairs(int** table, int a, int b) const
+{
+    if (a < 0 || b < 0) return 0;
+    return table[a][b] * (table[a][b] - 1) / 2;
+}
+
+void PairLeavesSets::fillPairsContingency(int** table)
 {
-// internNodes1Sizes[i] stores the number of pairs that node i is the ascentor of 
-// acording t the splitNode1 sense
-    int* internNodes1Sizes = new int[inNodesNum];        
-    int* internNodes2Sizes = new int[inNodesNum];
-    for (int a = 0; a < inNodesNum; a++) {
-        for (int b = 0; b < inNodesNum; b++) {
-            costMatrix[a][b] = 0;
+    int size1 = nodes1.size();
+    int size2 = nodes2.size();
+    // The common leaves of the subtrees, the sons rows are ready before their father's
+    for (int a = 0; a < size1; a++) {
+        int* row = table[a];
+        for (int b = 0; b < size2; b++) row[b] = 0;
+        for (int s = nodes1.sonsBegin[a]; s < nodes1.sonsBegin[a + 1]; s++) {
+            int son = nodes1.sons[s];
+            if (son >= 0) {
+                const int* sonRow = table[son];
+                for (int b = 0; b < size2; b++) row[b] += sonRow[b];
+            } else {
+                int rank = nodes2.leafRank[-1 - son];
+                for (int b = 0; b < size2; b++) {
+                    if (nodes2.firstLeaf[b] <= rank && rank < nodes2.firstLeaf[b] + nodes2.subLeavesNum[b]) row[b]++;
+                }
+            }
         }
-        internNodes1Sizes[a] = 0;
-        internNodes2Sizes[a] = 0;
     }
-
-    for (int i = 0; i < leavesNum; i++) {
-        for (int j = i+1; j < leavesNum; j++)  {
-            int internNode1 = splitNode1[i][j];
-            int internNode2 = splitNode2[i][j];
-            costMatrix[internNode1][internNode2]++;
-            internNodes1Sizes[internNode1]++;
-            internNodes2Sizes[internNode2]++;
+    // The pairs split exactly at a and b. The sons are processed after their fathers, 
+    // so they still keep the common leaves numbers.
+    for (int a = size1 - 1; a >= 0; a--) {
+        int sons1Begin = nodes1.sonsBegin[a], sons1End = nodes1.sonsBegin[a + 1];
+        for (int b = size2 - 1; b >= 0; b--) {
+            int sons2Begin = nodes2.sonsBegin[b], sons2End = nodes2.sonsBegin[b + 1];
+            int pairs = getCommonPairs(table, a, b);
+            for (int i = sons1Begin; i < sons1End; i++) {
+                int a1 = nodes1.sons[i];
+                pairs -= getCommonPairs(table, a1, b);
+                if (a1 < 0) continue;
+                for (int j = sons2Begin; j < sons2End; j++) {
+                    pairs += getCommonPairs(table, a1, nodes2.sons[j]);
+                }
+            }
+            for (int j = sons2Begin; j < sons2End; j++) {
+                pairs -= getCommonPairs(table, a, nodes2.sons[j]);
+            }
+            table[a][b] = pairs;
         }
     }
-    
-    // count costs and reverse values
+}
+
+int PairLeavesSets::getCostMatrix(int** costMatrix)
+{
+    int size1 = nodes1.size();
+    int size2 = nodes2.size();
+    fillPairsContingency(costMatrix);
+
+    // count costs, a dummy element has no pairs
     for (int i = 0; i < inNodesNum; i++) {
         for (int j = 0; j < inNodesNum; j++)  {
-            costMatrix[i][j] = internNodes1Sizes[i] + internNodes2Sizes[j] - 2*costMatrix[i][j];
+            if (i >= size1) {
+                costMatrix[i][j] = nodes2.pairsNum[j];
+            } else if (j >= size2) {
+                costMatrix[i][j] = nodes1.pairsNum[i];
+            } else {
+                costMatrix[i][j] = nodes1.pairsNum[i] + nodes2.pairsNum[j] - 2*costMatrix[i][j];
+            }
         }
     }
-    delete[] internNodes1Sizes;
-    delete[] internNodes2Sizes;
+    return inNodesNum;
 }
 
 
@@ -105,131 +153,175 @@ int PairLeavesSets::getCostMatrix(int** costMatrix)
 /*******************PARTITIONING************************
  *******************************************************/
     
-const int Partitioning::BITS_IN_INT = 32;
-int taxonNum_or_MaxInt;
 
 int Partitioning::getSize() {return largerBitList.size();}
 
-void Partitioning::getCostReversedMatrix(vector<vector<int> >& costMatrix)
-{
-    int taxonNum_or_MaxInt = taxonsNumber;
-    
-    int smallerSize = smallerBitList.size();
-    int largerSize = largerBitList.size();
-    
-    costMatrix.resize(largerSize);
-        
-    vector<int*>::iterator lIt;
-    vector<int*>::iterator sIt;
-
-    lIt = largerBitList.begin();
-    for (int a = 0; a < largerSize; a++) {        
-            costMatrix[a].resize(largerSize);
-        vector<int*>::iterator sIt = smallerBitList.begin();
-        for (int b = 0; b < smallerSize; b++) {
-            int a1b1 = 0;
-            int iterationsNum = taxonsNumber / (BITS_IN_INT*8) + 1;
-            for (int i = 0; i < iterationsNum; i++) {
-                a1b1 += getNumberOfSetBits( (*lIt)[i] ^ (*sIt)[i] );
-            }
-            a1b1 = taxonsNumber - a1b1;
-            costMatrix[a][b] = min(a1b1, taxonNum_or_MaxInt - a1b1);
-            sIt++;
-        }
-        lIt++;
-    }   
-
-    if (largerSize != smallerSize) {	// Usig dGMS1 for dummy v
-        lIt = largerBitList.begin();
-        for (int a = 0; a < largerSize; a++) {
-            for (int b = smallerSize; b < largerSize; b++) {
-                costMatrix[a][b] = (this->*dummyFun)(largerBitList.at(a));
-                sIt++;
-            }
-            lIt++;
-        }
-    }
-}
-
+int Partitioning::getLowerBound() {return smallerBitList.size();}
 
 int Partitioning::getCostMatrix(int** costMatrix)
 {    
     int smallerSize = smallerBitList.size();
     int largerSize = largerBitList.size();
 
-    vector<int*>::iterator lIt;
-    vector<int*>::iterator sIt;
-
-    lIt = largerBitList.begin();
-    for (int a = 0; a < largerSize; a++) {
-        vector<int*>::iterator sIt = smallerBitList.begin();
-        for (int b = 0; b < smallerSize; b++) {
-            int a1b1 = 0;
-            int iterationsNum = taxonsNumber / (BITS_IN_INT*8) + 1;
-            for (int i = 0; i < iterationsNum; i++) {
-                a1b1 += getNumberOfSetBits( (*lIt)[i] ^ (*sIt)[i] );
-            }                    
-            costMatrix[a][b] = min(a1b1, taxonNum_or_MaxInt - a1b1);
-            sIt++;
-        }
-        lIt++;
-    }   
+    BitCounting::countXorCostMatrix(largerWords, largerSize, smallerWords, smallerSize,
+                                    wordsNum, taxonNum_or_MaxInt, costMatrix);
 
     if (largerSize != smallerSize) {	// Usig dGMS1 for dummy v
-        lIt = largerBitList.begin();
         for (int a = 0; a < largerSize; a++) {
+            int dummyCost = (this->*dummyFun)(largerBitList.at(a));
             for (int b = smallerSize; b < largerSize; b++) {
-                costMatrix[a][b] = (this->*dummyFun)(largerBitList.at(a));
-                sIt++;
+                costMatrix[a][b] = dummyCost;
             }
-            lIt++;
         }
     }
     return largerSize;
 }
 
-int Partitioning::dummyFunction1(int* unused)
+int Partitioning::dummyFunction1(const uint64_t* unused)
 {
     return ceil( floor((double)taxonsNumber / 2) / 2);
 }
-int Partitioning::dummyFunction2(int* bitBipart)
+int Partitioning::dummyFunction2(const uint64_t* bitBipart)
 {
-    int count = 0;
-    int iterationsNum = taxonsNumber / BITS_IN_INT + 1;
-    for (int i = 0; i < iterationsNum; i++) {
-        count += getNumberOfSetBits(bitBipart[i]);
-    }
+    int count = BitCounting::countSetBits(bitBipart, wordsNum);
     return min (count, taxonsNumber - count);
 }
 
 Partitioning::~Partitioning()
 {
-    delete pl1;
-    delete pl2;
+    if (ownsLists) {
+        delete pl1;
+        delete pl2;
+    }
 }
 
-void Partitioning::setInitFields(const TreeTemplate<Node>& tr1, dummyFunType d)
+void Partitioning::setInitFields(int taxonsNum, dummyFunType d)
 {        
     if (pl1->size() > pl2->size()) {
         smallerBitList = pl2->getBitList();
         largerBitList = pl1->getBitList();
+        smallerWords = pl2->getWords();
+        largerWords = pl1->getWords();
     } else {
         smallerBitList = pl1->getBitList();
         largerBitList = pl2->getBitList();
+        smallerWords = pl1->getWords();
+        largerWords = pl2->getWords();
     }
-    taxonsNumber = tr1.getNumberOfLeaves();
+    taxonsNumber = taxonsNum;
+    wordsNum = pl1->getWordsCount();
     switch (d) {
         case GMS1 : {dummyFun = &Partitioning::dummyFunction1; break;}
         case GMS2 : {dummyFun = &Partitioning::dummyFunction2; break;}
     }
 }
 
+uint64_t Partitioning::getCanonicalWord(const uint64_t* bits, int i) const
+{
+    // A split and its complement are the same split, the canonical one does not contain leaf 0
+    uint64_t word = (complementEqual && (bits[0] & 1)) ? ~bits[i] : bits[i];
+    if (i == wordsNum - 1 && taxonsNumber % 64 != 0) {
+        word &= ((uint64_t)1 << (taxonsNumber % 64)) - 1;
+    }
+    return word;
+}
+
+uint64_t Partitioning::hashElement(const uint64_t* bits) const
+{
+    uint64_t hash = 0;
+    for (int i = 0; i < wordsNum; i++) {
+        hash = (hash ^ getCanonicalWord(bits, i)) * 0x9E3779B97F4A7C15ULL;
+        hash ^= hash >> 29;
+    }
+    return hash;
+}
+
+bool Partitioning::equalElements(const uint64_t* bits1, const uint64_t* bits2) const
+{
+    for (int i = 0; i < wordsNum; i++) {
+        if (getCanonicalWord(bits1, i) != getCanonicalWord(bits2, i)) return false;
+    }
+    return true;
+}
+
+void Partitioning::removeCommonElements()
+{
+    int smallerSize = smallerBitList.size();
+    int largerSize = largerBitList.size();
+    commonElementsNum = 0;
+    if (smallerSize == 0) return;
+
+    int slotsNum = 2;
+    while (slotsNum < 2 * smallerSize) slotsNum *= 2;
+    int mask = slotsNum - 1;
+    vector<int> slots(slotsNum, -1);
+    vector<uint64_t> hashes(smallerSize);
+    for (int b = 0; b < smallerSize; b++) {
+        hashes[b] = hashElement(smallerBitList[b]);
+        int slot = hashes[b] & mask;
+        while (slots[slot] != -1) slot = (slot + 1) & mask;
+        slots[slot] = b;
+    }
+
+    vector<bool> smallerMatched(smallerSize, false);
+    vector<bool> largerMatched(largerSize, false);
+    for (int a = 0; a < largerSize; a++) {
+        uint64_t hash = hashElement(largerBitList[a]);
+        for (int slot = hash & mask; slots[slot] != -1; slot = (slot + 1) & mask) {
+            int b = slots[slot];
+            if (!smallerMatched[b] && hashes[b] == hash && equalElements(largerBitList[a], smallerBitList[b])) {
+                smallerMatched[b] = true;
+                largerMatched[a] = true;
+                commonElementsNum++;
+                break;
+            }
+        }
+    }
+    if (commonElementsNum == 0) return;
+
+    // Pack the unmatched elements, so that the cost matrix kernel can stream them
+    largerResidualWords.resize((largerSize - commonElementsNum) * wordsNum + 1);
+    smallerResidualWords.resize((smallerSize - commonElementsNum) * wordsNum + 1);
+    vector<uint64_t*> largerResidual;
+    vector<uint64_t*> smallerResidual;
+    for (int a = 0; a < largerSize; a++) {
+        if (largerMatched[a]) continue;
+        uint64_t* element = &largerResidualWords[largerResidual.size() * wordsNum];
+        memcpy(element, largerBitList[a], wordsNum * sizeof(uint64_t));
+        largerResidual.push_back(element);
+    }
+    for (int b = 0; b < smallerSize; b++) {
+        if (smallerMatched[b]) continue;
+        uint64_t* element = &smallerResidualWords[smallerResidual.size() * wordsNum];
+        memcpy(element, smallerBitList[b], wordsNum * sizeof(uint64_t));
+        smallerResidual.push_back(element);
+    }
+    largerBitList.swap(largerResidual);
+    smallerBitList.swap(smallerResidual);
+    largerWords = &largerResidualWords[0];
+    smallerWords = &smallerResidualWords[0];
+}
+
 Splitting::Splitting(const TreeTemplate<Node>& tr1, const TreeTemplate<Node>& tr2, dummyFunType d) 
 {        
     pl1 = new BipartitionList(tr1); //BipartitionList bpl1(tr1, true);
     pl2 = new BipartitionList(tr2);
-    setInitFields(tr1, d);
+    ownsLists = true;
+    setInitFields(tr1.getNumberOfLeaves(), d);
+    taxonNum_or_MaxInt = taxonsNumber;
+    complementEqual = true;
+    removeCommonElements();
+}
+
+Splitting::Splitting(const PartitionList& splits1, const PartitionList& splits2, int taxonsNum, dummyFunType d) 
+{        
+    pl1 = &splits1;
+    pl2 = &splits2;
+    ownsLists = false;
+    setInitFields(taxonsNum, d);
     taxonNum_or_MaxInt = taxonsNumber;
+    complementEqual = true;
+    removeCommonElements();
 }
 
 
@@ -237,72 +329,36 @@ Clustering::Clustering(const TreeTemplate<Node>& tr1, const TreeTemplate<Node>&
 {	
     pl1 = new ClusterList(tr1);
     pl2 = new ClusterList(tr2);
-    setInitFields(tr1, d);
+    ownsLists = true;
+    setInitFields(tr1.getNumberOfLeaves(), d);
+    taxonNum_or_MaxInt = INT_MAX;
+    complementEqual = false;
+    removeCommonElements();
+}
+
+Clustering::Clustering(const PartitionList& clusters1, const PartitionList& clusters2, int taxonsNum, dummyFunType d)
+{	
+    pl1 = &clusters1;
+    pl2 = &clusters2;
+    ownsLists = false;
+    setInitFields(taxonsNum, d);
     taxonNum_or_MaxInt = INT_MAX;
+    complementEqual = false;
+    removeCommonElements();
 }
 
 
 //****************Deprecated*******************8
-int Clustering::countDistance(int *bitClust1, int *bitClust2)
+int Clustering::countDistance(const uint64_t *bitClust1, const uint64_t *bitClust2)
 {
-    int a1b1 = 0;
-    int iterationsNum = taxonsNumber / BITS_IN_INT + 1;
-    for (int i = 0; i < iterationsNum; i++) {
-        a1b1 += getNumberOfSetBits( bitClust1[i] ^ bitClust2[i] );
-    }
-    return a1b1;
+    return BitCounting::countXorSetBits(bitClust1, bitClust2, wordsNum);
 }
 
-int Splitting::countDistance(int *bitBipart1, int *bitBipart2)
+int Splitting::countDistance(const uint64_t *bitBipart1, const uint64_t *bitBipart2)
 {
-    int a1b1 = 0;
-    int iterationsNum = taxonsNumber / BITS_IN_INT + 1;
-    for (int i = 0; i < iterationsNum; i++) {
-        a1b1 += getNumberOfSetBits( bitBipart1[i] ^ bitBipart2[i] );
-    }
+    int a1b1 = BitCounting::countXorSetBits(bitBipart1, bitBipart2, wordsNum);
     return min(a1b1, taxonsNumber - a1b1);
 }
 
-int Partitioning::fixReversedWeightsSum(int sum)
-{
-    return taxonsNumber * largerBitList.size() - sum;
-}  
-
-void PairLeavesSets::getCostReversedMatrix(vector<vector<int> >& costMatrix)
-{
-    // internNodes1Sizes[i] stores the number of pairs that node i is the ascentor of 
-    // acording t the splitNode1 sense
-    int* internNodes1Sizes = new int[inNodesNum];        
-    int* internNodes2Sizes = new int[inNodesNum];
-    memset(internNodes1Sizes, 0, inNodesNum * sizeof(int));
-    memset(internNodes2Sizes, 0, inNodesNum * sizeof(int));
-
-    vector<int> emptyVec;
-    emptyVec.resize(inNodesNum, 0);
-    costMatrix.resize(inNodesNum, emptyVec);
-
-    for (int i = 0; i < leavesNum; i++) {
-        for (int j = i+1; j < leavesNum; j++)  {
-            int internNode1 = splitNode1[i][j];
-            int internNode2 = splitNode2[i][j];
-            costMatrix[internNode1][internNode2]++;
-            internNodes1Sizes[internNode1]++;
-            internNodes2Sizes[internNode2]++;
-        }
-    }
-
-    // count costs and reverse values
-    for (int i = 0; i < inNodesNum; i++) {
-        for (int j = 0; j < inNodesNum; j++)  {
-            costMatrix[i][j] = internNodes1Sizes[i] + internNodes2Sizes[j] - 2*costMatrix[i][j];
-            costMatrix[i][j] = leavesNum * leavesNum - 2*costMatrix[i][j];
-        }
-    }
-}
-int PairLeavesSets::fixReversedWeightsSum(int sum)
-{
-    return leavesNum * leavesNum * inNodesNum - sum ;// * (this->size * this->size) - dist;  
-}
-
 } // end of namespace
 
@@ -25,6 +25,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "PhylotreeDist.h"
 namespace dist {
 
+#ifdef HUNGARIAN
+PhylotreeDist::MatchingAlgorithm PhylotreeDist::matchingAlgorithm = PhylotreeDist::HUNGARIAN_ALGORITHM;
+#else
+PhylotreeDist::MatchingAlgorithm PhylotreeDist::matchingAlgorithm = PhylotreeDist::AUTO_SELECTION;
+#endif
+PhylotreeDist::QuartetAlgorithm PhylotreeDist::quartetAlgorithm = PhylotreeDist::QUARTET_AUTO_SELECTION;
+PhylotreeDist::TripletAlgorithm PhylotreeDist::tripletAlgorithm = PhylotreeDist::TRIPLET_AUTO_SELECTION;
+
 bool PhylotreeDist::checkLeavesNames(const TreeTemplate<Node>& trIn1, const TreeTemplate<Node>& trIn2)
             throw (bpp::Exception)
 {
@@ -53,25 +61,9 @@ int PhylotreeDist::robinsonFoulds(const TreeTemplate<Node>& trIn1, const TreeTem
     if (checkNames) {
         checkLeavesNames(trIn1, trIn2); 
     }
-    const TreeTemplate<Node> *tr1 = setNodesId ? tools::TreesManip::createOrderedTrees(trIn1) : &trIn1;
-    const TreeTemplate<Node> *tr2 = setNodesId ? tools::TreesManip::createOrderedTrees(trIn2) : &trIn2;
-
     //The algorithm  
-    if (!trIn2.isRooted()) {
-        if (checkNames) {
-        }
-            tr1 = tr1->clone();
-            tr2 = tr2->clone();
-        // Pay attention - changing tree to speed the algorithm
-        if (!trIn1.isRooted()) PostorderTree::rootTree(const_cast<TreeTemplate<Node>&>(*tr1));
-        if (!trIn2.isRooted()) PostorderTree::rootTree(const_cast<TreeTemplate<Node>&>(*tr2));
-    }      
-    PostorderTree pTrA(tr1->getRootNode());
-    PostorderTree pTrB(tr2->getRootNode());
-    ClusterTable *clusters = new ClusterTable(tr1->getNumberOfLeaves(), pTrA);
-    clusters->removeUncommonElements(pTrB);
-    return tr1->getNumberOfNodes() + tr2->getNumberOfNodes() - 2 * tr1->getNumberOfLeaves()
-            - 2 * clusters->getNumberOfInternalNodes();
+    RFReference reference(trIn1, setNodesId);
+    return reference.getDistance(trIn2, setNodesId);
 }   
 double PhylotreeDist::robinsonFouldsW(const TreeTemplate<Node>& trIn1, const TreeTemplate<Node>& trIn2, bool setNodesId, bool checkNames) 
             throw (bpp::Exception)
@@ -95,9 +87,9 @@ double PhylotreeDist::robinsonFouldsW(const TreeTemplate<Node>& trIn1, const Tre
 
     PostorderTree pTrA(tr1->getRootNode());
     PostorderTree pTrB(tr2->getRootNode());
-    ClusterTable *clusters = new ClusterTable(tr1->getNumberOfLeaves(), pTrA);
-    clusters->removeUncommonElements(pTrB);
-    double weight = clusters->getWeight();
+    ClusterTable clusters(tr1->getNumberOfLeaves(), pTrA);
+    clusters.removeUncommonElements(pTrB);
+    double weight = clusters.getWeight();
 
     vector<const Node*> l1 = tr1->getLeaves();
     vector<const Node*> l2 = tr2->getLeaves();
@@ -147,9 +139,6 @@ int PhylotreeDist::perfectMatching_pairs(const TreeTemplate<Node>& trIn1, const
 {	            
     checkRooted(true, trIn1, trIn2);
     if(checkNames) {
-        if (trIn1.isMultifurcating()) throw Exception("Multifurcating tree trIn1. Trees must be bifurcating.");
-        if (trIn2.isMultifurcating()) throw Exception("Multifurcating tree trIn2. Trees must be bifurcating.");
-
         checkLeavesNames(trIn1, trIn2);
     }
     const TreeTemplate<Node> *tr1 = setLeavesId ? tools::TreesManip::createOrderedTrees(trIn1) : &trIn1;
@@ -159,38 +148,122 @@ int PhylotreeDist::perfectMatching_pairs(const TreeTemplate<Node>& trIn1, const
     return getPMDistance(pairs);
 }
 
+const MatchingSolver& PhylotreeDist::getMatchingSolver(LapWorkspace& workspace)
+{
+    switch (matchingAlgorithm) {
+        case JONKER_VOLGENANT: return MatchingSolver::getJonkerVolgenant();
+        case HUNGARIAN_ALGORITHM: return MatchingSolver::getHungarian();
+        case AUCTION_ALGORITHM: return MatchingSolver::getAuction();
+        default: return MatchingSolver::choose(workspace);
+    }
+}
+
+bool PhylotreeDist::perfectMatching_splits_bounded(const TreeTemplate<Node>& trIn1, const TreeTemplate<Node>& trIn2, int threshold, bool setLeavesId, bool checkNames)
+    throw (Exception)
+{
+    checkRooted(false, trIn1, trIn2);
+    if (checkNames) {      
+        checkLeavesNames(trIn1, trIn2);
+    }
+    const TreeTemplate<Node> *tr1 = setLeavesId ? tools::TreesManip::createOrderedTrees(trIn1) : &trIn1;
+    const TreeTemplate<Node> *tr2 = setLeavesId ? tools::TreesManip::createOrderedTrees(trIn2) : &trIn2;
+
+    Splitting splitting(*tr1, *tr2);
+    return isPMDistanceWithin(splitting, threshold, LapWorkspace::getThreadWorkspace());
+}
+
+bool PhylotreeDist::perfectMatching_clusters_bounded(const TreeTemplate<Node>& trIn1, const TreeTemplate<Node>& trIn2, int threshold, bool setLeavesId, bool checkNames)
+    throw (Exception)
+{
+    checkRooted(true, trIn1, trIn2);
+    if (checkNames) {
+        checkLeavesNames(trIn1, trIn2);
+    }        
+    const TreeTemplate<Node> *tr1 = setLeavesId ? tools::TreesManip::createOrderedTrees(trIn1) : &trIn1;
+    const TreeTemplate<Node> *tr2 = setLeavesId ? tools::TreesManip::createOrderedTrees(trIn2) : &trIn2;
+
+    Clustering clustering(*tr1, *tr2);
+    return isPMDistanceWithin(clustering, threshold, LapWorkspace::getThreadWorkspace());
+}
+
+bool PhylotreeDist::perfectMatching_pairs_bounded(const TreeTemplate<Node>& trIn1, const TreeTemplate<Node>& trIn2, int threshold, bool setLeavesId, bool checkNames)
+    throw (Exception)
+{	            
+    checkRooted(true, trIn1, trIn2);
+    if(checkNames) {
+        checkLeavesNames(trIn1, trIn2);
+    }
+    const TreeTemplate<Node> *tr1 = setLeavesId ? tools::TreesManip::createOrderedTrees(trIn1) : &trIn1;
+    const TreeTemplate<Node> *tr2 = setLeavesId ? tools::TreesManip::createOrderedTrees(trIn2) : &trIn2;
+
+    PairLeavesSets pairs(*tr1, *tr2);           
+    return isPMDistanceWithin(pairs, threshold, LapWorkspace::getThreadWorkspace());
+}
+
+bool PhylotreeDist::isPMDistanceWithin(ITwoTreesDescriptionElements& descriptionElements, int threshold, LapWorkspace& workspace)
+{
+    int size = descriptionElements.getSize();
+    if (size == 0) return threshold >= 0;
+    if (descriptionElements.getLowerBound() > threshold) return false;
+
+    workspace.resize(size);
+    descriptionElements.getCostMatrix(workspace.getCostRows());
+    int** costs = workspace.getCostRows();
+    int* u = workspace.getRowDuals();
+    int* v = workspace.getColDuals();
+
+    // The row-min plus col-min reduction lower bound
+    long long lowerBound = 0;
+    for (int j = 0; j < size; j++) v[j] = INT_MAX;
+    for (int i = 0; i < size; i++) {
+        u[i] = costs[i][0];
+        for (int j = 1; j < size; j++) {
+            if (costs[i][j] < u[i]) u[i] = costs[i][j];
+        }
+        lowerBound += u[i];
+        for (int j = 0; j < size; j++) {
+            if (costs[i][j] - u[i] < v[j]) v[j] = costs[i][j] - u[i];
+        }
+    }
+    for (int j = 0; j < size; j++) lowerBound += v[j];
+    if (lowerBound > threshold) return false;
+
+    // The greedy assignment upper bound
+    int* taken = workspace.getMatches();
+    for (int j = 0; j < size; j++) taken[j] = 0;
+    long long upperBound = 0;
+    for (int i = 0; i < size; i++) {
+        int best = -1;
+        for (int j = 0; j < size; j++) {
+            if (!taken[j] && (best < 0 || costs[i][j] < costs[i][best])) best = j;
+        }
+        taken[best] = 1;
+        upperBound += costs[i][best];
+    }
+    if (upperBound <= threshold) return true;
+
+    return getMatchingSolver(workspace).solve(workspace) <= threshold;
+}
+
 int PhylotreeDist::getPMDistance(ITwoTreesDescriptionElements& descriptionElements)
+{	
+    return getPMDistance(descriptionElements, LapWorkspace::getThreadWorkspace());
+}
+
+int PhylotreeDist::getPMDistance(ITwoTreesDescriptionElements& descriptionElements, LapWorkspace& workspace)
 {	
 int distance;
+    // All the elements may have been matched with identical ones
+    if (descriptionElements.getSize() == 0) return 0;
 
-#ifdef HUNGARIAN
-    vector<vector<int> > costMatrix;
-    descriptionElements.getCostReversedMatrix(costMatrix);
-    distance = Hungarian::MaxWPerfectMatchingCost(costMatrix);
-    return descriptionElements.fixReversedWeightsSum(distance);  
-#else              
-    int size = descriptionElements.getSize(); 
-    int **assigncost = new int*[size];
-    for (int a = 0; a < size; a++) {
-        assigncost[a] = new int[size];
-    }
-    int *colsol = new int[size], *rowsol = new int[size];
-    int *u = new int[size], *v = new int[size];
+    workspace.resize(descriptionElements.getSize());
 
     // The exact functionality
-    descriptionElements.getCostMatrix(assigncost);  
-    distance = lap(size, assigncost, rowsol, colsol, u, v ); 
+    descriptionElements.getCostMatrix(workspace.getCostRows());  
+    distance = getMatchingSolver(workspace).solve(workspace);
     // The end of exact functionality
 
-    for (int i = 0; i < size; i++) 
-        delete[] assigncost[i];
-    delete[] assigncost;
-    delete[] colsol;
-    delete[] rowsol;
-    delete[] u;
-    delete[] v;
     return distance;
-#endif
 }
 
 
@@ -205,7 +278,7 @@ double PhylotreeDist::getNodalDistance(INodesDist* d, const TreeTemplate<Node>&
     }
     const TreeTemplate<Node> *tr1 = setLeavesId ? tools::TreesManip::createOrderedTrees(trIn1) : &trIn1;
     const TreeTemplate<Node> *tr2 = setLeavesId ? tools::TreesManip::createOrderedTrees(trIn2) : &trIn2;
-    d->init(trIn1, trIn2);
+    d->init(*tr1, *tr2);
     return d->getDistance();
 }
 
@@ -235,7 +308,7 @@ double PhylotreeDist::nodalDistanceW_pythagorean(const TreeTemplate<Node>& trIn1
 }
 
 
-int PhylotreeDist::quartetDistance(const TreeTemplate<Node>& trIn1, const TreeTemplate<Node>& trIn2, bool setLeavesId, bool checkNames)
+int64_t PhylotreeDist::quartetDistance(const TreeTemplate<Node>& trIn1, const TreeTemplate<Node>& trIn2, bool setLeavesId, bool checkNames)
     throw (Exception)
 {
     checkRooted(false, trIn1, trIn2); 
@@ -244,11 +317,31 @@ int PhylotreeDist::quartetDistance(const TreeTemplate<Node>& trIn1, const TreeTe
     }
     const TreeTemplate<Node> *tr1 = setLeavesId ? tools::TreesManip::createOrderedTrees(trIn1) : &trIn1;
     const TreeTemplate<Node> *tr2 = setLeavesId ? tools::TreesManip::createOrderedTrees(trIn2) : &trIn2;
+    if (useQuartetHDT(*tr1, *tr2)) {
+        QuartetDistanceHDT q(*tr1, *tr2);
+        return q.getDistance();
+    }
     QuartetDistance q(*tr1, *tr2);
     return q.getDistance();
 }
 
-int PhylotreeDist::tripletsDistance(const TreeTemplate<Node>& trIn1, const TreeTemplate<Node>& trIn2, bool setLeavesId, bool checkNames)
+bool PhylotreeDist::useQuartetHDT(const TreeTemplate<Node>& tr1, const TreeTemplate<Node>& tr2)
+    throw (Exception)
+{
+    switch (quartetAlgorithm) {
+        case QUARTET_ARBITRARY_DEGREE: 
+            return false;
+        case QUARTET_HIERARCHICAL_DECOMPOSITION: 
+            if (!QuartetDistanceHDT::isBinary(tr1) || !QuartetDistanceHDT::isBinary(tr2)) {
+                throw Exception("Multifurcating tree. Trees must be bifurcating.");
+            }
+            return true;
+        default:
+            return QuartetDistanceHDT::isBinary(tr1) && QuartetDistanceHDT::isBinary(tr2);
+    }
+}
+
+int64_t PhylotreeDist::tripletsDistance(const TreeTemplate<Node>& trIn1, const TreeTemplate<Node>& trIn2, bool setLeavesId, bool checkNames)
             throw (Exception)
 {            
     checkRooted(true, trIn1, trIn2);                
@@ -260,8 +353,6 @@ int PhylotreeDist::tripletsDistance(const TreeTemplate<Node>& trIn1, const TreeT
     const TreeTemplate<Node> *tr1 = setLeavesId ? tools::TreesManip::createOrderedTrees(trIn1) : &trIn1;
     const TreeTemplate<Node> *tr2 = setLeavesId ? tools::TreesManip::createOrderedTrees(trIn2) : &trIn2;
 
-    Triplets t(*tr1, *tr2);
-
 #ifdef TRIPL_NAIVE
     bool tr1IsBifurc = !trIn1.isMultifurcating() && !trIn2.isMultifurcating();
     GenerMatrixTree mTr1(*tr1);
@@ -272,9 +363,227 @@ int PhylotreeDist::tripletsDistance(const TreeTemplate<Node>& trIn1, const TreeT
         return mTr1.getTripletsDistance(mTr2);
     }
 #endif
+    if (useTripletsHDT(*tr1, *tr2)) {
+        TripletsHDT t(*tr1, *tr2);
+        return t.getDistance();
+    }
+    Triplets t(*tr1, *tr2);
     return t.getDistance();
     
 }
 
+bool PhylotreeDist::useTripletsHDT(const TreeTemplate<Node>& tr1, const TreeTemplate<Node>& tr2)
+    throw (Exception)
+{
+    switch (tripletAlgorithm) {
+        case TRIPLET_ARBITRARY_DEGREE: 
+            return false;
+        case TRIPLET_HIERARCHICAL_DECOMPOSITION: 
+            if (!TripletsHDT::isBinary(tr1) || !TripletsHDT::isBinary(tr2)) {
+                throw Exception("Multifurcating tree. Trees must be bifurcating.");
+            }
+            return true;
+        default:
+            return TripletsHDT::isBinary(tr1) && TripletsHDT::isBinary(tr2);
+    }
+}
+
+/*********************** Prepared trees ***********************/
+
+int PhylotreeDist::robinsonFoulds(const PreparedTree& tr1, const PreparedTree& tr2, bool checkNames) 
+            throw (bpp::Exception)
+{
+    //Constraints assurance  
+    if (tr1.isRooted()  ^ tr2.isRooted()) throw Exception("Bad input trees. Both tree must be either rooted or unrooted.");  
+    if (checkNames) {
+        checkLeavesNames(tr1.getTree(), tr2.getTree()); 
+    }
+    //The algorithm  
+    const TreeTemplate<Node>& rTr1 = tr1.getRootedTree();
+    const TreeTemplate<Node>& rTr2 = tr2.getRootedTree();
+    ClusterTable clusters(rTr1.getNumberOfLeaves(), tr1.getPostorderTree());
+    clusters.removeUncommonElements(tr2.getPostorderTree());
+    return rTr1.getNumberOfNodes() + rTr2.getNumberOfNodes() - 2 * rTr1.getNumberOfLeaves()
+            - 2 * clusters.getNumberOfInternalNodes();
+}   
+
+double PhylotreeDist::robinsonFouldsW(const PreparedTree& tr1, const PreparedTree& tr2, bool checkNames) 
+            throw (bpp::Exception)
+{
+    //Constraints assurance  
+    checkRooted(false, tr1.getTree(), tr2.getTree());
+    if (checkNames) {
+        checkLeavesNames(tr1.getTree(), tr2.getTree()); 
+    }
+    //The algorithm  
+    const TreeTemplate<Node>& rTr1 = tr1.getRootedTree();
+    const TreeTemplate<Node>& rTr2 = tr2.getRootedTree();
+    ClusterTable clusters(rTr1.getNumberOfLeaves(), tr1.getPostorderTree());
+    clusters.removeUncommonElements(tr2.getPostorderTree());
+    double weight = clusters.getWeight();
+
+    vector<const Node*> l1 = rTr1.getLeaves();
+    vector<const Node*> l2 = rTr2.getLeaves();
+    vector<double> weights;
+    weights.resize(l1.size(), 0);
+    for(vector<const Node*>::iterator itN = l1.begin(); itN != l1.end(); itN++) {
+        weights[(*itN)->getId()] = (*itN)->getDistanceToFather();
+    }
+    for(vector<const Node*>::iterator itN = l2.begin(); itN != l2.end(); itN++) {
+        weight += abs( weights[(*itN)->getId()] - (*itN)->getDistanceToFather());
+    }        
+    return weight;
+}   
+
+int PhylotreeDist::perfectMatching_splits(const PreparedTree& tr1, const PreparedTree& tr2, bool checkNames)
+    throw (Exception)
+{
+    checkRooted(false, tr1.getTree(), tr2.getTree());
+    if (checkNames) {      
+        checkLeavesNames(tr1.getTree(), tr2.getTree());
+    }
+    Splitting splitting(tr1.getPartitions(), tr2.getPartitions(), tr1.getNumberOfLeaves());
+    return getPMDistance(splitting);
+}
+
+int PhylotreeDist::perfectMatching_clusters(const PreparedTree& tr1, const PreparedTree& tr2, bool checkNames)
+    throw (Exception)
+{
+    checkRooted(true, tr1.getTree(), tr2.getTree());
+    if (checkNames) {
+        checkLeavesNames(tr1.getTree(), tr2.getTree());
+    }        
+    Clustering clustering(tr1.getPartitions(), tr2.getPartitions(), tr1.getNumberOfLeaves());
+    return getPMDistance(clustering);
+}
+
+int PhylotreeDist::perfectMatching_pairs(const PreparedTree& tr1, const PreparedTree& tr2, bool checkNames)
+    throw (Exception)
+{	            
+    checkRooted(true, tr1.getTree(), tr2.getTree());
+    if(checkNames) {
+        checkLeavesNames(tr1.getTree(), tr2.getTree());
+    }
+    PairLeavesSets pairs(tr1.getTree(), tr2.getTree());           
+    return getPMDistance(pairs);
+}
+
+bool PhylotreeDist::perfectMatching_splits_bounded(const PreparedTree& tr1, const PreparedTree& tr2, int threshold, bool checkNames)
+    throw (Exception)
+{
+    checkRooted(false, tr1.getTree(), tr2.getTree());
+    if (checkNames) {      
+        checkLeavesNames(tr1.getTree(), tr2.getTree());
+    }
+    Splitting splitting(tr1.getPartitions(), tr2.getPartitions(), tr1.getNumberOfLeaves());
+    return isPMDistanceWithin(splitting, threshold, LapWorkspace::getThreadWorkspace());
+}
+
+bool PhylotreeDist::perfectMatching_clusters_bounded(const PreparedTree& tr1, const PreparedTree& tr2, int threshold, bool checkNames)
+    throw (Exception)
+{
+    checkRooted(true, tr1.getTree(), tr2.getTree());
+    if (checkNames) {
+        checkLeavesNames(tr1.getTree(), tr2.getTree());
+    }        
+    Clustering clustering(tr1.getPartitions(), tr2.getPartitions(), tr1.getNumberOfLeaves());
+    return isPMDistanceWithin(clustering, threshold, LapWorkspace::getThreadWorkspace());
+}
+
+bool PhylotreeDist::perfectMatching_pairs_bounded(const PreparedTree& tr1, const PreparedTree& tr2, int threshold, bool checkNames)
+    throw (Exception)
+{	            
+    checkRooted(true, tr1.getTree(), tr2.getTree());
+    if(checkNames) {
+        checkLeavesNames(tr1.getTree(), tr2.getTree());
+    }
+    PairLeavesSets pairs(tr1.getTree(), tr2.getTree());           
+    return isPMDistanceWithin(pairs, threshold, LapWorkspace::getThreadWorkspace());
+}
+
+int64_t PhylotreeDist::quartetDistance(const PreparedTree& tr1, const PreparedTree& tr2, bool checkNames)
+    throw (Exception)
+{
+    checkRooted(false, tr1.getTree(), tr2.getTree()); 
+    if(checkNames) {
+        checkLeavesNames(tr1.getTree(), tr2.getTree());
+    }
+    if (useQuartetHDT(tr1.getTree(), tr2.getTree())) {
+        QuartetDistanceHDT q(tr1, tr2);
+        return q.getDistance();
+    }
+    QuartetDistance q(tr1, tr2);
+    return q.getDistance();
+}
+
+int64_t PhylotreeDist::tripletsDistance(const PreparedTree& tr1, const PreparedTree& tr2, bool checkNames)
+            throw (Exception)
+{            
+    checkRooted(true, tr1.getTree(), tr2.getTree());                
+    if(checkNames) {
+        checkLeavesNames(tr1.getTree(), tr2.getTree());
+    }
+    if (useTripletsHDT(tr1.getTree(), tr2.getTree())) {
+        TripletsHDT t(tr1, tr2);
+        return t.getDistance();
+    }
+    Triplets t(tr1, tr2);
+    return t.getDistance();
+}
+
+double PhylotreeDist::getNodalDistance(INodesDist* d, const PreparedTree& tr1, const PreparedTree& tr2, bool checkNames)
+    throw (Exception)
+{
+    checkRooted(false, tr1.getTree(), tr2.getTree()); 
+    if(checkNames) {
+        checkLeavesNames(tr1.getTree(), tr2.getTree());
+    }
+    d->init(tr1.getTree(), tr2.getTree());
+    return d->getDistance();
+}
+
+int PhylotreeDist::nodalDistance(const PreparedTree& tr1, const PreparedTree& tr2, bool checkNames)
+    throw (Exception)
+{
+    UnWeigthedNodesDist d(1);
+    return getNodalDistance(&d, tr1, tr2, checkNames);
+}
+double PhylotreeDist::nodalDistance_pythagorean(const PreparedTree& tr1, const PreparedTree& tr2, bool checkNames)
+    throw (Exception)
+{    
+    UnWeigthedNodesDist d(2);
+    return getNodalDistance(&d, tr1, tr2, checkNames);
+}
+double PhylotreeDist::nodalDistanceW(const PreparedTree& tr1, const PreparedTree& tr2, bool checkNames)
+    throw (Exception)
+{    
+    WeigthedNodesDist d(1);
+    return getNodalDistance(&d, tr1, tr2, checkNames);
+}
+double PhylotreeDist::nodalDistanceW_pythagorean(const PreparedTree& tr1, const PreparedTree& tr2, bool checkNames)
+    throw (Exception)
+{    
+    WeigthedNodesDist d(2);
+    return getNodalDistance(&d, tr1, tr2, checkNames);
+}
+vector<double> PhylotreeDist::nodalDistances(const PreparedTree& reference, const vector<PreparedTree*>& trees, bool weighted, int k, bool checkNames)
+    throw (Exception)
+{
+    LeavesPaths referencePaths(reference.getTree(), weighted);
+    referencePaths.cacheRows();
+    vector<double> distances;
+    distances.reserve(trees.size());
+    for (size_t i = 0; i < trees.size(); i++) {
+        const TreeTemplate<Node>& tr = trees[i]->getTree();
+        checkRooted(false, reference.getTree(), tr); 
+        if(checkNames) {
+            checkLeavesNames(reference.getTree(), tr);
+        }
+        LeavesPaths paths(tr, weighted);
+        distances.push_back(INodesDist::getDistance(referencePaths, paths, k));
+    }
+    return distances;
+}
+
 
 } // end of namespace
@@ -28,23 +28,21 @@ namespace tools {
 PostorderTree::PostorderTree(const Node* rootIn, bool isWeightedIn)
 {
     isWeighted = isWeightedIn;
-    Node root(*rootIn);
-    setPostorderList(root);
+    setPostorderList(rootIn);
     // Fake last node for the purposes of Day's R-F algorithm
-    NodeAgent* fakeAgent = new NodeAgent(-1, 0, -1000);
-    postorderNodes.push_back(fakeAgent);
+    addNode(-1, 0, -1000);
 }
 
 PostorderTree::PostorderTree(const PostorderTree& orig)
 {
-    postorderNodes = orig.postorderNodes;
+    nodeId = orig.nodeId;
+    subNodesSize = orig.subNodesSize;
+    branchW = orig.branchW;
+    isWeighted = orig.isWeighted;
 }
 
 PostorderTree::~PostorderTree()
 {
-    for (vector<NodeAgent*>::iterator it = postorderNodes.begin(); it != postorderNodes.end(); it++) {
-        delete *it;
-    }
 }
 
 void PostorderTree::rootTree(TreeTemplate<Node>& tr)
@@ -58,40 +56,43 @@ void PostorderTree::rootTree(TreeTemplate<Node>& tr)
     newRootNode->setDistanceToFather(1);
 }
 
-PostorderTree::NodeAgent* PostorderTree::operator[](int pos)
+int PostorderTree::getNumberOfNodes() const
 {
-    return getNodeAgent(pos);
+    // The number of elements without the fake node
+    return nodeId.size() - 1 ;
 }
 
-PostorderTree::NodeAgent* PostorderTree::getNodeAgent(int pos)
-{
-    return postorderNodes.at(pos);
-}
-int PostorderTree::getNumberOfNodes()
+void PostorderTree::addNode(int id, int subSize, double w)
 {
-    // The number of elements without fakeAgent
-    return postorderNodes.size() - 1 ;
+    nodeId.push_back(id);
+    subNodesSize.push_back(subSize);
+    branchW.push_back(w);
 }
 
-int PostorderTree::setPostorderList(Node& root)
+void PostorderTree::setPostorderList(const Node* root)
 {
-    if (root.isLeaf()) {
-        double w = isWeighted ? root.getDistanceToFather() : 1;
-        NodeAgent* agent = new NodeAgent(root.getId(), 0, w);
-        postorderNodes.push_back(agent);
-        return 1;
-    }
-
-    vector<Node*> sons = root.getSons() ;
-    int subtreeSize = 0;
-    for (vector<Node*>::iterator it = sons.begin(); it != sons.end(); it++) {
-        Node* n = *it;
-        subtreeSize += setPostorderList(*n);
+    /* Iterative DFS, so that deep (e.g. caterpillar) trees do not exhaust 
+     * the call stack. Each stack element keeps the node, the index of its
+     * next son to visit and the postorder position of its first descendant.
+     */
+    vector<DfsElement> dfsStack;
+    DfsElement rootElement = { root, 0, 0 };
+    dfsStack.push_back(rootElement);
+    while (!dfsStack.empty()) {
+        DfsElement& top = dfsStack.back();
+        const Node* node = top.node;
+        if (top.nextSon < (int)node->getNumberOfSons()) {
+            const Node* son = node->getSon(top.nextSon);
+            top.nextSon++;
+            DfsElement sonElement = { son, 0, (int)nodeId.size() };
+            dfsStack.push_back(sonElement);
+        } else {
+            int subtreeSize = nodeId.size() - top.firstPos;
+            double w = isWeighted ? node->getDistanceToFather() : 1;
+            addNode(node->getId(), subtreeSize, w);
+            dfsStack.pop_back();
+        }
     }
-    double w = isWeighted ? root.getDistanceToFather() : 1;
-    NodeAgent* agent = new NodeAgent(root.getId(), subtreeSize, w);
-    postorderNodes.push_back(agent);
-    return subtreeSize + 1;
 }
 
 
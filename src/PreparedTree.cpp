@@ -0,0 +1,79 @@
+//
+// File: PreparedTree.cpp
+// Created by: agent
+// Created on: 17 October 2026
+//
+
+/*
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "PreparedTree.h"
+namespace tools {
+
+PreparedTree::PreparedTree(const TreeTemplate<Node>& trIn, bool setLeavesId)
+{
+    orderedTree = setLeavesId ? TreesManip::createOrderedTrees(trIn) : trIn.clone();
+    if (orderedTree->isRooted()) {
+        rootedTree = orderedTree;
+        partitions = new ClusterList(*orderedTree);
+    } else {
+        rootedTree = orderedTree->clone();
+        PostorderTree::rootTree(*rootedTree);
+        partitions = new BipartitionList(*orderedTree);
+    }
+    postorderTree = new PostorderTree(rootedTree->getRootNode());
+
+    subTrSizes.resize(orderedTree->getNumberOfNodes(), 0);
+    countSubtreeSizes(orderedTree->getRootNode());
+}
+
+PreparedTree::~PreparedTree()
+{
+    delete postorderTree;
+    delete partitions;
+    if (rootedTree != orderedTree) delete rootedTree;
+    delete orderedTree;
+}
+
+/*
+ * The nodes are visited in the reversed preorder, so every son is counted before its father
+ * without the recursion that would overflow the stack on deep trees.
+ */
+void PreparedTree::countSubtreeSizes(const Node* root)
+{
+    vector<const Node*> preorder;
+    vector<const Node*> stack(1, root);
+    while (!stack.empty()) {
+        const Node* n = stack.back();
+        stack.pop_back();
+        preorder.push_back(n);
+        for (size_t i = 0; i < n->getNumberOfSons(); i++) {
+            stack.push_back(n->getSon(i));
+        }
+    }
+    for (vector<const Node*>::reverse_iterator it = preorder.rbegin(); it != preorder.rend(); it++) {
+        const Node* n = *it;
+        int size = n->getNumberOfSons() == 0 ? 1 : 0;
+        for (size_t i = 0; i < n->getNumberOfSons(); i++) {
+            size += subTrSizes[n->getSon(i)->getId()];
+        }
+        subTrSizes[n->getId()] = size;
+    }
+}
+
+} // end of namespace
@@ -24,82 +24,118 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "QuartetDistance.h"
+#include <pthread.h>
 using namespace bpp;
 using namespace std;
 
 
 namespace tools {    
     
-TreeParams2::TreeParams2(Node* root, int n, int l)
+TreeParams2::TreeParams2(Node* root, int n, int l, const vector<int>* subTrSizes)
 {  
     inSize = n - l;
     lSize = l;
     rootId = root->getId() - l;
 
     subTr = new int[inSize * 2];
-    countSubTrSize(root); 
+    inFather = new int[inSize];
+    leafFather = new int[l];
+    inPostorder = new int[inSize];
+    firstLeaf = new int[inSize];
+    leavesOrder = new int[l];
+    setNodes(root, subTrSizes == NULL);
+    if (subTrSizes != NULL) {
+        for (int id = l; id < n; id++) subTr[id - l] = (*subTrSizes)[id];
+    }
 
-    inSons = new list<int>[inSize];
-    setInSons(root, rootId);
+    // the internal sons in the compressed rows, grouped by the father with a counting sort
+    inSonsBegin = new int[inSize + 1];
+    inSonsIds = new int[inSize];
+    for (int v = 0; v <= inSize; v++) inSonsBegin[v] = 0;
+    for (int v = 0; v < inSize; v++) {
+        if (inFather[v] >= 0) inSonsBegin[inFather[v] + 1]++;
+    }
+    for (int v = 0; v < inSize; v++) inSonsBegin[v + 1] += inSonsBegin[v];
+    vector<int> next(inSonsBegin, inSonsBegin + inSize);
+    for (int v = 0; v < inSize; v++) {
+        if (inFather[v] >= 0) inSonsIds[next[inFather[v]]++] = v;
+    }
 }
 TreeParams2::~TreeParams2()
 {
     delete[] subTr;
-    delete[] inSons;
+    delete[] inSonsBegin;
+    delete[] inSonsIds;
+    delete[] inFather;
+    delete[] leafFather;
+    delete[] inPostorder;
+    delete[] firstLeaf;
+    delete[] leavesOrder;
 }
 
-int TreeParams2::choose2(int a)
+int64_t TreeParams2::choose2(int a)
 {
-    return a * (a-1) / 2;
+    return (int64_t) a * (a - 1) / 2;
 }
-int TreeParams2::choose3(int a)
+int64_t TreeParams2::choose3(int a)
 {
-    return a * (a - 1) * (a - 2) / (2 * 3);
-}
-
-int TreeParams2::countSubTrSize(Node* r)
-{
-    vector<Node*> s = r->getSons();
-    if (s.size() == 0) {
-        return 1;           // a leaf
-    }
-    int id = r->getId() - lSize;
-    subTr[id] = 0;
-    for (vector<Node*>::iterator it = s.begin(); it != s.end(); it++) {
-        subTr[id] += countSubTrSize(*it);
-    }
-    return subTr[id];
+    return (int64_t) a * (a - 1) * (a - 2) / (2 * 3);
 }
 
-void TreeParams2::setInSons(Node* root, int rootNewId)
+/*
+ * The nodes are visited in preorder (the leaves order) and left in postorder. 
+ * On the stack a node comes with its father's id, or with VISITED when its sons are done.
+ */
+void TreeParams2::setNodes(Node* root, bool countSubTr)
 {
-    vector<Node*> sons = root->getSons();        
-    for (vector<Node*>::iterator sonIt = sons.begin(); sonIt != sons.end(); sonIt++) {
-        int sonId = (*sonIt)->getId() - lSize;
-        if (sonId > 0) {
-            inSons[rootNewId].push_back(sonId);
-            setInSons(*sonIt, sonId);
-        }          
+    const int VISITED = -2;
+    vector<pair<Node*, int> > stack(1, make_pair(root, -1));
+    int leavesNum = 0;
+    int postorderNum = 0;
+    while (!stack.empty()) {
+        Node* node = stack.back().first;
+        int father = stack.back().second;
+        stack.pop_back();
+        int id = node->getId() - lSize;
+        if (id < 0) {
+            leafFather[node->getId()] = father;
+            leavesOrder[leavesNum++] = node->getId();
+        } else if (father == VISITED) {
+            inPostorder[postorderNum++] = id;
+            if (countSubTr) subTr[id] = leavesNum - firstLeaf[id];
+        } else {
+            inFather[id] = father;
+            firstLeaf[id] = leavesNum;
+            stack.push_back(make_pair(node, VISITED));
+            for (int s = node->getNumberOfSons() - 1; s >= 0; s--) {
+                stack.push_back(make_pair(node->getSon(s), id));
+            }
+        }
     }
 }
 
 
 QuartetDistance::QuartetDistance(const TreeTemplate<Node>& tr1In, const TreeTemplate<Node>& tr2In)
+{ 
+    init(tr1In, tr2In, NULL, NULL);
+}
+QuartetDistance::QuartetDistance(const PreparedTree& tr1In, const PreparedTree& tr2In)
+{ 
+    init(tr1In.getTree(), tr2In.getTree(), &tr1In.getSubtreeSizes(), &tr2In.getSubtreeSizes());
+}
+void QuartetDistance::init(const TreeTemplate<Node>& tr1In, const TreeTemplate<Node>& tr2In, const vector<int>* subTrSizes1, const vector<int>* subTrSizes2)
 { 
     lSize = tr1In.getNumberOfLeaves();
     r1 = const_cast<Node*> (tr1In.getRootNode());
     r2 = const_cast<Node*> (tr2In.getRootNode());
-    trP1 = new TreeParams2(r1, tr1In.getNumberOfNodes(), lSize);
-    trP2 = new TreeParams2(r2, tr2In.getNumberOfNodes(), lSize);  
+    trP1 = new TreeParams2(r1, tr1In.getNumberOfNodes(), lSize, subTrSizes1);
+    trP2 = new TreeParams2(r2, tr2In.getNumberOfNodes(), lSize, subTrSizes2);  
 
     intersection = new int*[trP1->inSize];
     for (int i = 0; i < trP1->inSize; i++) {
         intersection[i] = new int[trP2->inSize];
-        for (int j = 0; j < trP2->inSize; j++) {
-            intersection[i][j] = -1;
-        }
     }
-    countIntersection(r1, r2);
+    runRows(INTERSECTION_ROWS);
 }
 QuartetDistance::~QuartetDistance()
 {
@@ -111,297 +147,387 @@ QuartetDistance::~QuartetDistance()
     delete trP2;
 }
 
-int QuartetDistance::getDistance()
+int QuartetDistance::threadsNumber = 1;
+
+struct QuartetDistance::RowsScratch
+{
+    // getSharedRow
+    vector<int64_t> S1, S1_neg, S2, S2_neg;
+    // getNonsharedRow
+    vector<int> cell;               // |x ^ y| for the internal sons and the rest of the tree
+    vector<int> rowSize, colSize;
+    vector<int64_t> rowDot, colDot; // sum over y of |x ^ y| * |y|, including the one-leaf parts
+    vector<int64_t> rowSq, colSq;   // sum over y of |x ^ y| ^ 2, including the one-leaf parts
+    vector<int64_t> colSqIn;        // the same for the columns, without the one-leaf parts
+    vector<int64_t> rowsDot;        // sum over y of |x ^ y| * |x' ^ y|
+    vector<int> rows, cols;         // the internal sons and the node itself (for the rest of the tree)
+};
+
+struct QuartetDistance::RowsJob
+{
+    QuartetDistance* quartets;
+    RowsKernel kernel;
+    // The next row to take, incremented atomically
+    volatile int nextRow;
+};
+
+struct QuartetDistance::RowsWorker
+{
+    RowsJob* job;
+    QuartetSum sum;
+};
+
+QuartetDistance::QuartetSum QuartetDistance::runRows(RowsKernel kernel)
+{
+    RowsJob job;
+    job.quartets = this;
+    job.kernel = kernel;
+    job.nextRow = 0;
+    int threadsNum = trP1->inSize < PARALLEL_MIN_NODES ? 1 : threadsNumber;
+
+    vector<pthread_t> threads(threadsNum);
+    vector<RowsWorker> workers(threadsNum);
+    for (int t = 0; t < threadsNum; t++) {
+        workers[t].job = &job;
+        workers[t].sum = 0;
+    }
+    // The calling thread is the worker 0
+    for (int t = 1; t < threadsNum; t++) {
+        pthread_create(&threads[t], NULL, processRows, &workers[t]);
+    }
+    processRows(&workers[0]);
+    QuartetSum sum = workers[0].sum;
+    for (int t = 1; t < threadsNum; t++) {
+        pthread_join(threads[t], NULL);
+        sum += workers[t].sum;
+    }
+    return sum;
+}
+
+void* QuartetDistance::processRows(void* worker)
 {
-    int B1 = getSingleTrQuartetsSize(trP1->inSize, trP1->subTr, trP1->inSons);
-    int B2 = getSingleTrQuartetsSize(trP2->inSize, trP2->subTr, trP2->inSons);
-    int S = getShared();
-    int N = getNonshared();
+    RowsWorker& rowsWorker = *(RowsWorker*)worker;
+    RowsJob& job = *rowsWorker.job;
+    QuartetDistance& q = *job.quartets;
+    RowsScratch scratch;
+    if (job.kernel == SHARED_ROWS) {
+        scratch.S1.assign(q.trP1->inSize, 0);
+        scratch.S1_neg.assign(q.trP1->inSize, 0);
+        scratch.S2.assign(q.trP2->inSize, 0);
+        scratch.S2_neg.assign(q.trP2->inSize, 0);
+    }
+    for (int v1 = __sync_fetch_and_add(&job.nextRow, 1); v1 < q.trP1->inSize; v1 = __sync_fetch_and_add(&job.nextRow, 1)) {
+        switch (job.kernel) {
+            case INTERSECTION_ROWS: q.countIntersectionRow(v1); break;
+            case SHARED_ROWS: rowsWorker.sum += q.getSharedRow(v1, scratch); break;
+            case NONSHARED_ROWS: rowsWorker.sum += q.getNonsharedRow(v1, scratch); break;
+        }
+    }
+    return NULL;
+}
+
+int64_t QuartetDistance::getDistance()
+{
+    int64_t B1 = getSingleTrQuartetsSize(trP1);
+    int64_t B2 = getSingleTrQuartetsSize(trP2);
+    int64_t S = getShared();
+    int64_t N = getNonshared();
     return B1 + B2 - 2 * S - N;
 }
     
-int QuartetDistance::getNonshared()
+/*
+ * The leaves are partitioned by v1 into the subtrees of its sons and the rest of the tree,
+ * and by v2 in the same way. A quartet ab|cd of tr1 being ac|bd in tr2 is counted at (v1, v2) 
+ * if a, b are in one part x of v1 and c, d in two other parts of v1, while a, c are in one part y 
+ * of v2 and b, d in two other parts of v2. Every such quartet is counted 4 times (twice in each tree)
+ * for the ordered choices of a, b, c, d - the sum is divided by 4 at the end.
+ * For the fixed cell (x, y) of a, the leaves b and c are summed over the rows x' != x and the 
+ * columns y' != y, the number of leaves d outside the rows x, x' and the columns y, y' is found 
+ * by the inclusion-exclusion principle. 
+ * The sons being leaves make one-leaf parts. They can not hold a or the three-cells products,
+ * so they are counted only by the sums of the rows and columns.
+ */
+int64_t QuartetDistance::getNonshared()
 {
-    int nonshared = 0;
-    
-    for (int v1 = 0; v1 < trP1->inSize; v1++) {
-        list<int> I = trP1->inSons[v1];
-        for (int v2 = 0; v2 < trP2->inSize; v2++) {
-            list<int> J = trP2->inSons[v2];     
-            
-            for (list<int>::iterator it1 = I.begin(); it1 != I.end(); it1++ ) {
-                for (list<int>::iterator it2 = J.begin(); it2 != J.end(); it2++ ) {
-                    int i = *it1, j = *it2;
-                    nonshared += in_a_b(i, j) * in_a_bneg(i, j) * in_aneg_b(i, j) * in_aneg_bneg(i, j);
-                    
-                    for (list<int>::iterator it1_k = I.begin(); it1_k != I.end(); it1_k++ ) {
-                        if (it1 != it1_k){ 
-                            nonshared -= in_a_b(i, j) * in_a_bneg(i, j) * in_a_b(*it1_k, j) * in_a_bneg(*it1_k, j);  
-                        }           
-                    } 
-                    nonshared -= in_a_b(i, j) * in_a_bneg(i, j) * in_aneg_b(v1, j) * in_aneg_bneg(v1, j); 
-                    
-                    for (list<int>::iterator it2_l = J.begin(); it2_l  != J.end(); it2_l++ ) {
-                        if (it2 != it2_l) { 
-                            nonshared -= in_a_b(i, j) * in_aneg_b(i, j) * in_a_b(i, *it2_l) * in_aneg_b(i, *it2_l);         
-                        }
-                    }
-                    nonshared -= in_a_b(i, j) * in_aneg_b(i, j) * in_a_bneg(i, v2) * in_aneg_bneg(i, v2);  
-                    
-                    for (list<int>::iterator it1_k = I.begin(); it1_k != I.end(); it1_k++ ) {
-                        for (list<int>::iterator it2_l = J.begin(); it2_l  != J.end(); it2_l++ ) {
-                            if (it1 != it1_k && it2 != it2_l) {
-                                nonshared += in_a_b(i, j) * in_a_b(i, *it2_l) * in_a_b(*it1_k, j) * in_a_b(*it1_k, *it2_l);
-                            }                
-                        }  
-                        nonshared += in_a_b(i, j) * in_a_bneg(i, v2) * in_a_b(*it1_k, j) * in_a_bneg(*it1_k, v2);                    
-                    }
-                    for (list<int>::iterator it2_l = J.begin(); it2_l  != J.end(); it2_l++ ) {
-                        nonshared += in_a_b(i, j) * in_a_b(i, *it2_l) * in_aneg_b(v1, j) * in_aneg_b(v1, *it2_l);                        
-                    }
-                    nonshared += in_a_b(i, j) * in_a_bneg(i, v2) * in_aneg_b(v1, j) * in_aneg_bneg(v1, v2);
-                }
-            }
-            
-            for (list<int>::iterator it2 = J.begin(); it2 != J.end(); it2++ ) {
-                int j = *it2;
-                nonshared += in_aneg_b(v1, j) * in_aneg_bneg(v1, j) * in_a_b(v1, j) * in_a_bneg(v1, j);
-
-                for (list<int>::iterator it1_k = I.begin(); it1_k != I.end(); it1_k++ ) {
-                        nonshared -= in_aneg_b(v1, j) * in_aneg_bneg(v1, j) * in_a_b(*it1_k, j) * in_a_bneg(*it1_k, j);  
-                } 
-                for (list<int>::iterator it2_l = J.begin(); it2_l  != J.end(); it2_l++ ) {
-                    if (it2 != it2_l) { 
-                        nonshared -= in_aneg_b(v1, j) * in_a_b(v1, j) * in_aneg_b(v1, *it2_l) * in_a_b(v1, *it2_l);         
-                    }
-                }
-                nonshared -= in_aneg_b(v1, j) * in_a_b(v1, j) * in_aneg_bneg(v1, v2) * in_a_bneg(v1, v2); 
-                
-                for (list<int>::iterator it1_k = I.begin(); it1_k != I.end(); it1_k++ ) {
-                    for (list<int>::iterator it2_l = J.begin(); it2_l  != J.end(); it2_l++ ) {
-                        if (it2 != it2_l) {
-                            nonshared += in_aneg_b(v1, j) * in_aneg_b(v1, *it2_l) * in_a_b(*it1_k, j) * in_a_b(*it1_k, *it2_l);
-                        }                
-                    }    
-                    nonshared += in_aneg_b(v1, j) * in_aneg_bneg(v1, v2) * in_a_b(*it1_k, j) * in_a_bneg(*it1_k, v2);                  
-                }
-            }
-                        
-            for (list<int>::iterator it1 = I.begin(); it1 != I.end(); it1++ ) {
-                int i = *it1;
-                nonshared += in_a_bneg(i, v2) * in_a_b(i, v2) * in_aneg_bneg(i, v2) * in_aneg_b(i, v2);
-
-                for (list<int>::iterator it1_k = I.begin(); it1_k != I.end(); it1_k++ ) {
-                    if (it1 != it1_k){ 
-                        nonshared -= in_a_bneg(i, v2) * in_a_b(i, v2) * in_a_bneg(*it1_k, v2) * in_a_b(*it1_k, v2);  
-                    }           
-                } 
-                nonshared -= in_a_bneg(i, v2) * in_a_b(i, v2) * in_aneg_bneg(v1, v2) * in_aneg_b(v1, v2);  
+    return (int64_t) (runRows(NONSHARED_ROWS) / 4);
+}
 
-                for (list<int>::iterator it2_l = J.begin(); it2_l  != J.end(); it2_l++ ) {
-                        nonshared -= in_a_bneg(i, v2) * in_aneg_bneg(i, v2) * in_a_b(i, *it2_l) * in_aneg_b(i, *it2_l); 
-                }
-                
-                for (list<int>::iterator it2_l = J.begin(); it2_l  != J.end(); it2_l++ ) {
-                    for (list<int>::iterator it1_k = I.begin(); it1_k != I.end(); it1_k++ ) {                 
-                        if (it1 != it1_k) {
-                            nonshared += in_a_bneg(i, v2) * in_a_b(i, *it2_l) * in_a_bneg(*it1_k, v2) * in_a_b(*it1_k, *it2_l);
-                        }                
-                    }  
-                    nonshared += in_a_bneg(i, v2) * in_a_b(i, *it2_l) * in_aneg_bneg(v1, v2) * in_aneg_b(v1, *it2_l);
-                }                
+QuartetDistance::QuartetSum QuartetDistance::getNonsharedRow(int v1, RowsScratch& scratch)
+{
+    QuartetSum nonshared = 0;
+    vector<int>& cell = scratch.cell;
+    vector<int>& rowSize = scratch.rowSize;
+    vector<int>& colSize = scratch.colSize;
+    vector<int64_t>& rowDot = scratch.rowDot;
+    vector<int64_t>& colDot = scratch.colDot;
+    vector<int64_t>& rowSq = scratch.rowSq;
+    vector<int64_t>& colSq = scratch.colSq;
+    vector<int64_t>& colSqIn = scratch.colSqIn;
+    vector<int64_t>& rowsDot = scratch.rowsDot;
+    vector<int>& rows = scratch.rows;
+    vector<int>& cols = scratch.cols;
+
+    rows.assign(trP1->sonsBegin(v1), trP1->sonsEnd(v1));
+    rows.push_back(v1);
+    int rowsNum = rows.size();
+    for (int v2 = 0; v2 < trP2->inSize; v2++) {
+        cols.assign(trP2->sonsBegin(v2), trP2->sonsEnd(v2));
+        cols.push_back(v2);
+        int colsNum = cols.size();
+
+        cell.assign(rowsNum * colsNum, 0);
+        for (int x = 0; x < rowsNum - 1; x++) {
+            for (int y = 0; y < colsNum - 1; y++) {
+                cell[x * colsNum + y] = in_a_b(rows[x], cols[y]);
             }
-            
-            
-            nonshared += in_a_b(v1,v2) * in_a_bneg(v1,v2) * in_aneg_b(v1,v2) * in_aneg_bneg(v1,v2);
-
-            for (list<int>::iterator it1_k = I.begin(); it1_k != I.end(); it1_k++ ) {
-                    nonshared -= in_aneg_bneg(v1,v2) * in_aneg_b(v1,v2) * in_a_bneg(*it1_k, v2) * in_a_b(*it1_k, v2);  
+            cell[x * colsNum + colsNum - 1] = in_a_bneg(rows[x], v2);
+        }
+        for (int y = 0; y < colsNum - 1; y++) {
+            cell[(rowsNum - 1) * colsNum + y] = in_aneg_b(v1, cols[y]);
+        }
+        cell[rowsNum * colsNum - 1] = in_aneg_bneg(v1, v2);
+
+        rowSize.assign(rowsNum, 0);
+        colSize.assign(colsNum, 0);
+        for (int x = 0; x < rowsNum - 1; x++) rowSize[x] = trP1->subTr[rows[x]];
+        rowSize[rowsNum - 1] = lSize - trP1->subTr[v1];
+        for (int y = 0; y < colsNum - 1; y++) colSize[y] = trP2->subTr[cols[y]];
+        colSize[colsNum - 1] = lSize - trP2->subTr[v2];
+
+        rowDot.assign(rowsNum, 0);
+        rowSq.assign(rowsNum, 0);
+        colDot.assign(colsNum, 0);
+        colSq.assign(colsNum, 0);
+        colSqIn.assign(colsNum, 0);
+        for (int x = 0; x < rowsNum; x++) {
+            int covered = 0;
+            for (int y = 0; y < colsNum; y++) {
+                int m = cell[x * colsNum + y];
+                covered += m;
+                rowDot[x] += (int64_t) m * colSize[y];
+                rowSq[x] += (int64_t) m * m;
+                colDot[y] += (int64_t) m * rowSize[x];
+                colSqIn[y] += (int64_t) m * m;
             }
-
-            for (list<int>::iterator it2_l = J.begin(); it2_l  != J.end(); it2_l++ ) {
-                    nonshared -= in_aneg_bneg(v1,v2) * in_a_bneg(v1,v2) * in_aneg_b(v1, *it2_l) * in_a_b(v1, *it2_l); 
+            // the leaves of x being sons of v2
+            rowDot[x] += rowSize[x] - covered;
+            rowSq[x] += rowSize[x] - covered;
+        }
+        for (int y = 0; y < colsNum; y++) {
+            int covered = 0;
+            for (int x = 0; x < rowsNum; x++) covered += cell[x * colsNum + y];
+            // the leaves of y being sons of v1
+            colDot[y] += colSize[y] - covered;
+            colSq[y] = colSqIn[y] + colSize[y] - covered;
+        }
+        rowsDot.assign(rowsNum * rowsNum, 0);
+        for (int x = 0; x < rowsNum; x++) {
+            for (int x2 = x; x2 < rowsNum; x2++) {
+                int64_t dot = 0;
+                for (int y = 0; y < colsNum; y++) dot += (int64_t) cell[x * colsNum + y] * cell[x2 * colsNum + y];
+                rowsDot[x * rowsNum + x2] = rowsDot[x2 * rowsNum + x] = dot;
             }
+        }
 
-            for (list<int>::iterator it1_k = I.begin(); it1_k != I.end(); it1_k++ ) {
-                for (list<int>::iterator it2_l = J.begin(); it2_l  != J.end(); it2_l++ ) {
-                        nonshared += in_aneg_bneg(v1,v2) * in_aneg_b(v1, *it2_l) * in_a_bneg(*it1_k, v2) * in_a_b(*it1_k, *it2_l);
-                }                     
-            }   
+        for (int x = 0; x < rowsNum; x++) {
+            for (int y = 0; y < colsNum; y++) {
+                int64_t m = cell[x * colsNum + y];
+                if (m == 0) continue;
+                int64_t A = rowSize[x] - m;         // the leaves b
+                int64_t B = colSize[y] - m;         // the leaves c
+                // sum over x' != x, y' != y of |x ^ y'| * |x' ^ y| * |x' ^ y'|
+                QuartetSum T = 0;
+                for (int x2 = 0; x2 < rowsNum; x2++) {
+                    T += (QuartetSum) cell[x2 * colsNum + y] * rowsDot[x * rowsNum + x2];
+                }
+                T -= (QuartetSum) m * rowsDot[x * rowsNum + x] + (QuartetSum) m * colSqIn[y] - (QuartetSum) m * m * m;
+
+                QuartetSum val = (QuartetSum) A * B * (lSize - rowSize[x] - colSize[y] + m)
+                    - (QuartetSum) A * (colDot[y] - m * rowSize[x])
+                    - (QuartetSum) B * (rowDot[x] - m * colSize[y])
+                    + (QuartetSum) B * (rowSq[x] - m * m)
+                    + (QuartetSum) A * (colSq[y] - m * m)
+                    + T;
+                nonshared += m * val;
+            }
         }
     }
     
-    return nonshared / 4;
+    return nonshared;
 }
             
-int QuartetDistance::getShared()
+/*
+ * S1[i], S1_neg[i] (S2[j], S2_neg[j]) are indexed by the node ids, only the internal sons 
+ * of v1 (v2) and v1 (v2) itself are used in one iteration, so only they are reset.
+ */
+int64_t QuartetDistance::getShared()
+{
+    return (int64_t) (runRows(SHARED_ROWS) / 2);
+}
+
+QuartetDistance::QuartetSum QuartetDistance::getSharedRow(int v1, RowsScratch& scratch)
 {
-    int shared = 0;
+    QuartetSum shared = 0;
+    vector<int64_t>& S1 = scratch.S1;
+    vector<int64_t>& S1_neg = scratch.S1_neg;
+    vector<int64_t>& S2 = scratch.S2;
+    vector<int64_t>& S2_neg = scratch.S2_neg;
     
-    for (int v1 = 0; v1 < trP1->inSize; v1++) {
-        list<int> I = trP1->inSons[v1];                 // SPR CZY 0
-        for (int v2 = 0; v2 < trP2->inSize; v2++) {
-            list<int> J = trP2->inSons[v2];            
-            
-            list<int>::iterator it1;
-            list<int>::iterator it2;                  
-            int S1[trP1->inSize], S1_neg[trP1->inSize];
-            int S2[trP2->inSize], S2_neg[trP2->inSize];
-            int minSize = min(trP1->inSize, trP2->inSize);
-            for (int i = 0; i < minSize; i++) {S1[i] = 0; S1_neg[i] = 0; S2[i] = 0; S2_neg[i] = 0;}
-            for (int i = minSize; i < trP1->inSize; i++) {S1[i] = 0; S1_neg[i] = 0;}
-            for (int i = minSize; i < trP2->inSize; i++) {S2[i] = 0; S2_neg[i] = 0;}
-            int S = 0;
-            
+    const int* IBegin = trP1->sonsBegin(v1);
+    const int* IEnd = trP1->sonsEnd(v1);
+    for (int v2 = 0; v2 < trP2->inSize; v2++) {
+        const int* JBegin = trP2->sonsBegin(v2);
+        const int* JEnd = trP2->sonsEnd(v2);
+        
+        const int* it1;
+        const int* it2;                  
+        for (it1 = IBegin; it1 != IEnd; it1++) {S1[*it1] = 0; S1_neg[*it1] = 0;}
+        for (it2 = JBegin; it2 != JEnd; it2++) {S2[*it2] = 0; S2_neg[*it2] = 0;}
+        S1[v1] = 0; S1_neg[v1] = 0; S2[v2] = 0; S2_neg[v2] = 0;
+        int64_t S = 0;
+        
 //******** S *****************************            
-            for (it1 = I.begin(); it1 != I.end(); it1++ ) {
-                int i = *it1;
-                for (it2 = J.begin(); it2 != J.end(); it2++ ) {
-                    int j = *it2;
-                    S1[i] += a_b(i, j);
-                    S1_neg[i] += aneg_b(i, j);  
-                    
-                    S += a_b(i, j);                    
-                }                
-                S1[i] += a_bneg(i, v2); 
-                S1_neg[i] += aneg_bneg(i, v2);
-                
-                S2[v2] += a_bneg(i, v2);
-                S2_neg[v2] += a_b(i, v2);
-                
-                S += a_bneg(i, v2);                
-            } 
-       
-            
-            for (it2 = J.begin(); it2 != J.end(); it2++ ) {   
-            int j = *it2;  
-                for (it1 = I.begin(); it1 != I.end(); it1++ ) {
-                    int i = *it1;
-                    S2[j] += a_b(i, j); 
-                    S2_neg[j] += a_bneg(i, j);
-                }                
-                S2[j] += aneg_b(v1, j);    
-                S2_neg[j] += aneg_bneg(v1, j); 
-                
-                S1[v1] += aneg_b(v1, j);   
-                S1_neg[v1] += a_b(v1, j); 
+        for (it1 = IBegin; it1 != IEnd; it1++ ) {
+            int i = *it1;
+            for (it2 = JBegin; it2 != JEnd; it2++ ) {
+                int j = *it2;
+                S1[i] += a_b(i, j);
+                S1_neg[i] += aneg_b(i, j);  
                 
-                S += aneg_b(v1, j); 
-            } 
+                S += a_b(i, j);                    
+            }                
+            S1[i] += a_bneg(i, v2); 
+            S1_neg[i] += aneg_bneg(i, v2);
             
-            S1[v1] += aneg_bneg(v1, v2);   
-            S1_neg[v1] += a_bneg(v1, v2); 
-            S2[v2] += aneg_bneg(v1, v2);   
-            S2_neg[v2] += aneg_b(v1, v2);      
+            S2[v2] += a_bneg(i, v2);
+            S2_neg[v2] += a_b(i, v2);
             
-            S += aneg_bneg(v1, v2);
-                   
-//******** EQUATION *****************************
-            for (it1 = I.begin(); it1 != I.end(); it1++ ) {
+            S += a_bneg(i, v2);                
+        } 
+   
+        
+        for (it2 = JBegin; it2 != JEnd; it2++ ) {   
+        int j = *it2;  
+            for (it1 = IBegin; it1 != IEnd; it1++ ) {
                 int i = *it1;
-                for (it2 = J.begin(); it2 != J.end(); it2++ ) {
-                    int j = *it2;
-                    int val = 
-                        a_b(i, j) * (
-                            aneg_bneg(i, j)
-                            + (a_bneg(i, j) -  S2_neg[j])
-                            + (aneg_b(i, j) -  S1_neg[i])
-                            + (S - S1[i] - S2[j] + a_b(i, j))
-                        );
-                    shared += val;
-                }
-            }        
+                S2[j] += a_b(i, j); 
+                S2_neg[j] += a_bneg(i, j);
+            }                
+            S2[j] += aneg_b(v1, j);    
+            S2_neg[j] += aneg_bneg(v1, j); 
             
-            if (v2 != r2->getId() - lSize) {
-                for (it1 = I.begin(); it1 != I.end(); it1++ ) {
-                    int i = *it1;    
-                    int val = 
-                        a_bneg(i, v2) * (
-                            aneg_b(i, v2)
-                            + (a_b(i, v2) -  S2_neg[v2])
-                            + (aneg_bneg(i, v2) -  S1_neg[i])
-                            + (S - S1[i] - S2[v2] + a_bneg(i, v2))
-                        );
-                    shared += val;                   
-                } 
-            }
-            if (v1 != r1->getId() - lSize) {
-                for (it1 = J.begin(); it1 != J.end(); it1++ ) {
-                    int j = *it1;
-                    int val =  
-                            aneg_b(v1, j) * (
-                                a_bneg(v1, j)
-                                + (aneg_bneg(v1, j) -  S2_neg[j])
-                                + (a_b(v1, j) -  S1_neg[v1])
-                                + (S - S1[v1] - S2[j] + aneg_b(v1, j))
-                            );
-                    shared += val;                    
-                }
-            }
-            if (v1 != r1->getId() - lSize && v2 != r2->getId() - lSize) {
-                int val =  
-                    aneg_bneg(v1, v2) * (
-                        a_b(v1, v2)
-                        + (aneg_b(v1, v2) -  S2_neg[v2])
-                        + (a_bneg(v1, v2) -  S1_neg[v1])
-                        + (S - S1[v1] - S2[v2] + aneg_bneg(v1, v2))
+            S1[v1] += aneg_b(v1, j);   
+            S1_neg[v1] += a_b(v1, j); 
+            
+            S += aneg_b(v1, j); 
+        } 
+        
+        S1[v1] += aneg_bneg(v1, v2);   
+        S1_neg[v1] += a_bneg(v1, v2); 
+        S2[v2] += aneg_bneg(v1, v2);   
+        S2_neg[v2] += aneg_b(v1, v2);      
+        
+        S += aneg_bneg(v1, v2);
+               
+//******** EQUATION *****************************
+        for (it1 = IBegin; it1 != IEnd; it1++ ) {
+            int i = *it1;
+            for (it2 = JBegin; it2 != JEnd; it2++ ) {
+                int j = *it2;
+                QuartetSum val = 
+                    (QuartetSum) a_b(i, j) * (
+                        aneg_bneg(i, j)
+                        + (a_bneg(i, j) -  S2_neg[j])
+                        + (aneg_b(i, j) -  S1_neg[i])
+                        + (S - S1[i] - S2[j] + a_b(i, j))
                     );
                 shared += val;
             }
+        }        
+        
+        if (v2 != trP2->rootId) {
+            for (it1 = IBegin; it1 != IEnd; it1++ ) {
+                int i = *it1;    
+                QuartetSum val = 
+                    (QuartetSum) a_bneg(i, v2) * (
+                        aneg_b(i, v2)
+                        + (a_b(i, v2) -  S2_neg[v2])
+                        + (aneg_bneg(i, v2) -  S1_neg[i])
+                        + (S - S1[i] - S2[v2] + a_bneg(i, v2))
+                    );
+                shared += val;                   
+            } 
         }
-    }  
+        if (v1 != trP1->rootId) {
+            for (it2 = JBegin; it2 != JEnd; it2++ ) {
+                int j = *it2;
+                QuartetSum val =  
+                        (QuartetSum) aneg_b(v1, j) * (
+                            a_bneg(v1, j)
+                            + (aneg_bneg(v1, j) -  S2_neg[j])
+                            + (a_b(v1, j) -  S1_neg[v1])
+                            + (S - S1[v1] - S2[j] + aneg_b(v1, j))
+                        );
+                shared += val;                    
+            }
+        }
+        if (v1 != trP1->rootId && v2 != trP2->rootId) {
+            QuartetSum val =  
+                (QuartetSum) aneg_bneg(v1, v2) * (
+                    a_b(v1, v2)
+                    + (aneg_b(v1, v2) -  S2_neg[v2])
+                    + (a_bneg(v1, v2) -  S1_neg[v1])
+                    + (S - S1[v1] - S2[v2] + aneg_bneg(v1, v2))
+                );
+            shared += val;
+        }
+    }
     
-    return shared / 2;
+    return shared;
 }
 
-int QuartetDistance::getSingleTrQuartetsSize(int size, int* subTrsize, list<int>* inSons)
+int64_t QuartetDistance::getSingleTrQuartetsSize(const TreeParams2* trP)
 {
-    int single = 0;    
-    for (int v = 0; v < size; v++) {
-        int Ss =0;
-        list<int> &I = inSons[v];
-        for (list<int>::iterator it = I.begin(); it != I.end(); it++) {
+    QuartetSum single = 0;    
+    const int* subTrsize = trP->subTr;
+    for (int v = 0; v < trP->inSize; v++) {
+        int64_t Ss =0;
+        for (const int* it = trP->sonsBegin(v); it != trP->sonsEnd(v); it++) {
             Ss += binomCoef_bin(subTrsize[*it]);
         }
         Ss += binomCoef_bin(lSize - subTrsize[v]);
         
         
-        for (list<int>::iterator it = I.begin(); it != I.end(); it++) {        
-            single += binomCoef_bin(subTrsize[*it]) * ( binomCoef_bin(lSize - subTrsize[*it]) - Ss + binomCoef_bin(subTrsize[*it]));
+        for (const int* it = trP->sonsBegin(v); it != trP->sonsEnd(v); it++) {        
+            single += (QuartetSum) binomCoef_bin(subTrsize[*it]) * ( binomCoef_bin(lSize - subTrsize[*it]) - Ss + binomCoef_bin(subTrsize[*it]));
         }
-        single += binomCoef_bin(lSize - subTrsize[v]) * ( binomCoef_bin(subTrsize[v]) - Ss + binomCoef_bin(lSize - subTrsize[v]));
+        single += (QuartetSum) binomCoef_bin(lSize - subTrsize[v]) * ( binomCoef_bin(subTrsize[v]) - Ss + binomCoef_bin(lSize - subTrsize[v]));
     }
-    return single / 2;
+    return (int64_t) (single / 2);
 }
 
-int QuartetDistance::binomCoef_bin(int a)
+int64_t QuartetDistance::binomCoef_bin(int a)
 {
-    return a * (a-1) / 2;
+    return (int64_t) a * (a - 1) / 2;
 }
 
 
-int QuartetDistance::non_product(int i, int j)
-{
-    return a_b(i, j) * a_bneg(i, j) * aneg_b(i, j) * aneg_bneg(i, j);
-            
-}
-      
-int QuartetDistance::a_b(int i, int j)
+int64_t QuartetDistance::a_b(int i, int j)
 {
     return binomCoef_n_2(intersection[i][j]);
 }
 
-int QuartetDistance::aneg_bneg(int i, int j)
+int64_t QuartetDistance::aneg_bneg(int i, int j)
 {
     return binomCoef_n_2(lSize - (trP1->subTr[i] + trP2->subTr[j] - intersection[i][j]));
 }
 
-int QuartetDistance::a_bneg(int i, int j)
+int64_t QuartetDistance::a_bneg(int i, int j)
 {
     return binomCoef_n_2(trP1->subTr[i] - intersection[i][j]);
 }
     
-int QuartetDistance::aneg_b(int i, int j)
+int64_t QuartetDistance::aneg_b(int i, int j)
 {
     return binomCoef_n_2(trP2->subTr[j] - intersection[i][j]);
 }
@@ -426,40 +552,22 @@ int QuartetDistance::in_aneg_b(int i, int j)
     return (trP2->subTr[j] - intersection[i][j]);
 }
     
-int QuartetDistance::countIntersection(Node* root1, Node* root2)
+void QuartetDistance::countIntersectionRow(int v1)
 {
-    int id1 = root1->getId() - lSize;
-    int id2 = root2->getId() - lSize;
-    bool internal = (min(id1, id2) >=0) ? true : false;
-    if (internal && intersection[id1][id2] != -1) return intersection[id1][id2];
-
-    int val = 0;
-    vector<Node*> s1 = root1->getSons();
-    vector<Node*> s2 = root2->getSons();
-
-    if (s1.size() == 0 && s2.size() == 0) {
-        return id1 == id2;
+    int* row = intersection[v1];
+    for (int v2 = 0; v2 < trP2->inSize; v2++) row[v2] = 0;
+    for (int k = trP1->firstLeaf[v1]; k < trP1->firstLeaf[v1] + trP1->subTr[v1]; k++) {
+        row[trP2->leafFather[trP1->leavesOrder[k]]]++;
     }
-
-    for (vector<Node*>::iterator it1 = s1.begin(); it1 != s1.end(); it1++) {
-        val += countIntersection(*it1, root2);
-        for (vector<Node*>::iterator it2 = s2.begin(); it2 != s2.end(); it2++) {
-            val -= countIntersection(*it1, *it2);            
-        }
-    }        
-    for (vector<Node*>::iterator it2 = s2.begin(); it2 != s2.end(); it2++) {
-        val += countIntersection(root1, *it2);
-    }  
-
-    if (internal) {
-        intersection[id1][id2] = val;
+    for (int k = 0; k < trP2->inSize; k++) {
+        int v2 = trP2->inPostorder[k];
+        if (trP2->inFather[v2] >= 0) row[trP2->inFather[v2]] += row[v2];
     }
-    return val;
 }
 
-int QuartetDistance::binomCoef_n_2(int x)
+int64_t QuartetDistance::binomCoef_n_2(int x)
 {
-    return x * (x-1) / 2;
+    return (int64_t) x * (x - 1) / 2;
 }
 
 } // end of namespace
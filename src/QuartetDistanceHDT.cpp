@@ -0,0 +1,204 @@
+//
+// File: QuartetDistanceHDT.cpp
+// Created by: agent
+// Created on: 17 October 2026
+//
+
+/*
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "QuartetDistanceHDT.h"
+#include <cstring>
+using namespace bpp;
+using namespace std;
+
+namespace tools {
+
+QuartetDistanceHDT::QuartetDistanceHDT(const TreeTemplate<Node>& tr1In, const TreeTemplate<Node>& tr2In)
+    throw (Exception)
+{
+    // the root of tr2 gets 2 sons, so every node of a heavy path has one light son
+    init(tr1In, tr2In, true);
+}
+QuartetDistanceHDT::QuartetDistanceHDT(const PreparedTree& tr1In, const PreparedTree& tr2In)
+    throw (Exception)
+{
+    init(tr1In.getTree(), tr2In.getTree(), true);
+}
+QuartetDistanceHDT::~QuartetDistanceHDT()
+{
+}
+
+int QuartetDistanceHDT::addPoly(bool hole)
+{
+    if (hole) {
+        holePolys.push_back(HolePoly());
+        memset(&holePolys.back(), 0, sizeof(HolePoly));
+        return holePolys.size() - 1;
+    }
+    freePolys.push_back(FreePoly());
+    memset(&freePolys.back(), 0, sizeof(FreePoly));
+    return freePolys.size() - 1;
+}
+
+/*
+ * The node of the unit has the parts: U (up), H (down) and the light subtree with the colours counts s.
+ * It is the middle node of the quartets with the pair in one part and two leaves of the other 
+ * two colours in the two other parts. The nodes of the light subtree see U and H as one part.
+ */
+void QuartetDistanceHDT::countUnit(Component& unit)
+{
+    const Component& light = components[unit.left];
+    const FreePoly& l = freePolys[light.poly];
+    HolePoly& p = holePolys[unit.poly];
+    memset(&p, 0, sizeof(HolePoly));
+    const int* s = light.cnt;
+    for (int k = 0; k < COLOURS; k++) unit.cnt[k] = s[k];
+
+    // l(U + H), C(U + H, 2) = C(U, 2) + U H + C(H, 2)
+    p.c = l.c;
+    for (int k = 0; k < COLOURS; k++) {
+        p.u[k] = p.h[k] = l.u[k];
+        p.uu[k] = p.hh[k] = p.uh[k][k] = l.uu[k];
+    }
+    for (int k = 0; k < COLOURS; k++) {
+        int i = (k + 1) % COLOURS, j = (k + 2) % COLOURS;
+        // the pair up
+        p.uuh[k][i] += s[j];
+        p.uuh[k][j] += s[i];
+        // the pair down
+        p.uhh[i][k] += s[j];
+        p.uhh[j][k] += s[i];
+        // the pair in the light subtree
+        p.uh[i][j] += choose2(s[k]);
+        p.uh[j][i] += choose2(s[k]);
+    }
+}
+
+/*
+ * comp(U, H) = upper(U, lower + H) + lower(U + upper, H), where upper and lower denote 
+ * also the colours counts of the parts.
+ */
+void QuartetDistanceHDT::countCompressed(Component& comp)
+{
+    const Component& upperComp = components[comp.left];
+    const Component& lowerComp = components[comp.right];
+    const HolePoly& a = holePolys[upperComp.poly];
+    const int* ca = upperComp.cnt;
+    const int* cb = lowerComp.cnt;
+    int64_t ca2[COLOURS], cb2[COLOURS];
+    for (int k = 0; k < COLOURS; k++) {
+        comp.cnt[k] = ca[k] + cb[k];
+        ca2[k] = choose2(ca[k]);
+        cb2[k] = choose2(cb[k]);
+    }
+
+    if (comp.hole) {
+        const HolePoly& b = holePolys[lowerComp.poly];
+        HolePoly& p = holePolys[comp.poly];
+        p = a;
+        // a(U, cb + H)
+        for (int k = 0; k < COLOURS; k++) {
+            p.c += a.h[k] * cb[k] + a.hh[k] * cb2[k];
+            p.h[k] += a.hh[k] * cb[k];
+            for (int i = 0; i < COLOURS; i++) {
+                p.u[i] += a.uh[i][k] * cb[k] + a.uhh[i][k] * cb2[k];
+                p.uu[k] += a.uuh[k][i] * cb[i];
+                p.uh[i][k] += a.uhh[i][k] * cb[k];
+            }
+        }
+        // b(ca + U, H)
+        p.c += b.c;
+        for (int k = 0; k < COLOURS; k++) {
+            p.c += b.u[k] * ca[k] + b.uu[k] * ca2[k];
+            p.u[k] += b.u[k] + b.uu[k] * ca[k];
+            p.h[k] += b.h[k];
+            p.uu[k] += b.uu[k];
+            p.hh[k] += b.hh[k];
+            for (int i = 0; i < COLOURS; i++) {
+                p.h[i] += b.uh[k][i] * ca[k] + b.uuh[k][i] * ca2[k];
+                p.hh[k] += b.uhh[i][k] * ca[i];
+                p.uh[k][i] += b.uh[k][i] + b.uuh[k][i] * ca[k];
+                p.uuh[k][i] += b.uuh[k][i];
+                p.uhh[k][i] += b.uhh[k][i];
+            }
+        }
+    } else {
+        const FreePoly& b = freePolys[lowerComp.poly];
+        FreePoly& p = freePolys[comp.poly];
+        // a(U, cb)
+        p.c = a.c;
+        for (int k = 0; k < COLOURS; k++) {
+            p.c += a.h[k] * cb[k] + a.hh[k] * cb2[k];
+            p.u[k] = a.u[k];
+            p.uu[k] = a.uu[k];
+            for (int i = 0; i < COLOURS; i++) {
+                p.u[k] += a.uh[k][i] * cb[i] + a.uhh[k][i] * cb2[i];
+                p.uu[k] += a.uuh[k][i] * cb[i];
+            }
+        }
+        // b(ca + U)
+        p.c += b.c;
+        for (int k = 0; k < COLOURS; k++) {
+            p.c += b.u[k] * ca[k] + b.uu[k] * ca2[k];
+            p.u[k] += b.u[k] + b.uu[k] * ca[k];
+            p.uu[k] += b.uu[k];
+        }
+    }
+}
+
+int64_t QuartetDistanceHDT::getCounted()
+{
+    return freePolys[components[rootComponent].poly].c;
+}
+
+int64_t QuartetDistanceHDT::getShared()
+{
+    if (lSize < 4) return 0;
+    int64_t twiceShared = 0;
+    int root = 0;
+    if (sons1[3 * root + 2] < 0) {
+        processPath(root, false, twiceShared);
+    } else {
+        // the root with 3 sons: the heavy one coloured 1, the next 2, the last 0
+        int heavy = getHeavySon(root);
+        int others[2], o = 0;
+        for (int s = 0; s < 3; s++) {
+            if (sons1[3 * root + s] != heavy) others[o++] = sons1[3 * root + s];
+        }
+        processPath(others[0], false, twiceShared);
+        processPath(others[1], false, twiceShared);
+        processPath(heavy, true, twiceShared);
+        paint(others[0], 2);
+        twiceShared += getCounted();
+        paint(root, 0);
+    }
+    return twiceShared / 2;
+}
+
+int64_t QuartetDistanceHDT::getDistance()
+{
+    int64_t n = lSize;
+    if (n < 4) return 0;
+    // C(n, 4) = C(n, 3) (n - 3) / 4 without overflowing the product
+    int64_t triples = n * (n - 1) / 2 * (n - 2) / 3;
+    int64_t all = triples / 4 * (n - 3) + triples % 4 * (n - 3) / 4;
+    return all - getShared();
+}
+
+} // end of namespace
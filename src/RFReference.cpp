@@ -0,0 +1,117 @@
+//
+// File: RFReference.cpp
+// Created by: agent
+// Created on: 17 October 2026
+//
+
+/*
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <NumCalc/VectorTools.h>
+#include "RFReference.h"
+namespace dist {
+
+RFReference::RFReference(const TreeTemplate<Node>& refIn, bool setNodesId)
+{
+    refTree = setNodesId ? TreesManip::createOrderedTrees(refIn) : refIn.clone();
+    rooted = refIn.isRooted();
+    // Pay attention - changing tree to speed the algorithm
+    if (!rooted) PostorderTree::rootTree(*refTree);
+    init(refIn.getLeavesNames());
+}
+
+RFReference::RFReference(const PreparedTree& refIn)
+{
+    refTree = refIn.getRootedTree().clone();
+    rooted = refIn.isRooted();
+    init(refIn.getTree().getLeavesNames());
+}
+
+RFReference::~RFReference()
+{
+    delete clusters;
+    delete postorderTree;
+    delete refTree;
+}
+
+void RFReference::init(const vector<string>& names)
+{
+    leavesNames = names;
+    refNodesNum = refTree->getNumberOfNodes();
+    leavesNum = refTree->getNumberOfLeaves();
+    postorderTree = new PostorderTree(refTree->getRootNode());
+    clusters = new ClusterTable(leavesNum, *postorderTree);
+}
+
+void RFReference::checkQuery(const TreeTemplate<Node>& trIn, bool checkNames)
+        throw (bpp::Exception)
+{
+    if (trIn.isRooted() ^ rooted) throw Exception("Bad input trees. Both tree must be either rooted or unrooted.");
+    if (checkNames) {
+        if(!VectorTools::haveSameElements(leavesNames, trIn.getLeavesNames()))
+            throw Exception("Trees have different sets of leaves.\n");
+    }
+}
+
+int RFReference::getDistance(const TreeTemplate<Node>& trIn, bool setNodesId, bool checkNames)
+        throw (bpp::Exception)
+{
+    checkQuery(trIn, checkNames);
+    const TreeTemplate<Node>* tr = &trIn;
+    TreeTemplate<Node>* ownTr = NULL;
+    if (setNodesId) {
+        ownTr = TreesManip::createOrderedTrees(trIn);
+    } else if (!rooted) {
+        ownTr = trIn.clone();
+    }
+    if (ownTr != NULL) {
+        // Pay attention - changing tree to speed the algorithm
+        if (!rooted) PostorderTree::rootTree(*ownTr);
+        tr = ownTr;
+    }
+    PostorderTree pTr(tr->getRootNode());
+    int dist = getDistance(pTr, tr->getNumberOfNodes());
+    delete ownTr;
+    return dist;
+}
+
+int RFReference::getDistance(const PreparedTree& tr, bool checkNames)
+        throw (bpp::Exception)
+{
+    checkQuery(tr.getTree(), checkNames);
+    return getDistance(tr.getPostorderTree(), tr.getRootedTree().getNumberOfNodes());
+}
+
+vector<int> RFReference::getDistances(const vector<TreeTemplate<Node>*>& trees, bool setNodesId, bool checkNames)
+        throw (bpp::Exception)
+{
+    vector<int> distances;
+    distances.reserve(trees.size());
+    for (vector<TreeTemplate<Node>*>::const_iterator it = trees.begin(); it != trees.end(); it++) {
+        distances.push_back(getDistance(**it, setNodesId, checkNames));
+    }
+    return distances;
+}
+
+int RFReference::getDistance(const PostorderTree& pTr, int nodesNum)
+{
+    clusters->removeUncommonElements(pTr);
+    return refNodesNum + nodesNum - 2 * leavesNum - 2 * clusters->getNumberOfInternalNodes();
+}
+
+} // end of namespace
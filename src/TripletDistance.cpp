@@ -26,105 +26,137 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 using namespace bpp;
 using namespace std;
 namespace tools {
-TreeParams::TreeParams(Node* root, int n, int l)
+TreeParams::TreeParams(Node* root, int n, int l, const vector<int>* subTrSizes)
 {  
     inSize = n;
     lSize = l;
     rootId = root->getId() - lSize;
 
-    subTr = new int[inSize * 2];
-    countSubTrSize(root); 
+    subTr = new int[inSize];
+    inFather = new int[inSize];
+    leafFather = new int[l];
+    inPostorder = new int[inSize];
+    firstLeaf = new int[inSize];
+    leavesOrder = new int[l];
+    setNodes(root, subTrSizes == NULL);
+    if (subTrSizes != NULL) {
+        for (int i = 0; i < inSize; i++) subTr[i] = (*subTrSizes)[i + l];
+    }
 
-    inSons = new list<int>[inSize];
-    setInSons(root, rootId);
+    // the internal sons in the compressed rows, grouped by the father with a counting sort
+    inSonsBegin = new int[inSize + 1];
+    inSonsIds = new int[inSize];
+    for (int v = 0; v <= inSize; v++) inSonsBegin[v] = 0;
+    for (int v = 0; v < inSize; v++) {
+        if (inFather[v] >= 0) inSonsBegin[inFather[v] + 1]++;
+    }
+    for (int v = 0; v < inSize; v++) inSonsBegin[v + 1] += inSonsBegin[v];
+    vector<int> next(inSonsBegin, inSonsBegin + inSize);
+    for (int v = 0; v < inSize; v++) {
+        if (inFather[v] >= 0) inSonsIds[next[inFather[v]]++] = v;
+    }
 }
 TreeParams::~TreeParams()
 {
     delete[] subTr;
-    delete[] inSons;
-}
-int TreeParams::getResolved()
+    delete[] inSonsBegin;
+    delete[] inSonsIds;
+    delete[] inFather;
+    delete[] leafFather;
+    delete[] inPostorder;
+    delete[] firstLeaf;
+    delete[] leavesOrder;
+}
+int64_t TreeParams::getResolved()
 {  
-    int result = 0;
-    for (list<int>::iterator sIt = inSons[rootId].begin(); sIt != inSons[rootId].end(); sIt++) {
-        result += getResolved_in(*sIt);
+    int64_t result = 0;
+    for (int id = 0; id < inSize; id++) {
+        if (id == rootId) continue;
+        result += choose2(subTr[id]) * (lSize - subTr[id]);
+        for (const int* s = sonsBegin(id); s != sonsEnd(id); s++) {
+            result -= choose2(subTr[*s]) * (lSize - subTr[id]);
+        }
     }
     return result;
 }
-int TreeParams::getUnresolved(int R)
+int64_t TreeParams::getUnresolved(int64_t R)
 {  
     return choose3(lSize) - R;
 }
 
-int TreeParams::getResolved_in(int id)
-{  
-    int res = 0 ;
-    res += choose2(subTr[id]) * (lSize - subTr[id]);
-    for (list<int>::iterator sIt = inSons[id].begin(); sIt != inSons[id].end(); sIt++) {
-        res -= choose2(subTr[*sIt]) * (lSize - subTr[id]);
-        res += getResolved_in(*sIt);
-    } 
-    return res;
-}
-int TreeParams::choose2(int a)
+int64_t TreeParams::choose2(int a)
 {
-    return a * (a-1) / 2;
+    return (int64_t) a * (a - 1) / 2;
 }
-int TreeParams::choose3(int a)
+int64_t TreeParams::choose3(int a)
 {
-    return a * (a - 1) * (a - 2) / (2 * 3);
+    return (int64_t) a * (a - 1) * (a - 2) / (2 * 3);
 }
 
-int TreeParams::countSubTrSize(Node* r)
-{
-    vector<Node*> s = r->getSons();
-    if (s.size() == 0) {
-        return 1;           // a leaf
-    }
-    int id = r->getId() - lSize;
-    subTr[id] = 0;
-    for (vector<Node*>::iterator it = s.begin(); it != s.end(); it++) {
-        subTr[id] += countSubTrSize(*it);
-    }
-    return subTr[id];
-}
-//collecting sons being internal nodes. Attantion! Internal nodes have ids >= l
-void TreeParams::setInSons(Node* root, int rootNewId)
+/*
+ * The nodes are visited in preorder (the leaves order) and left in postorder. 
+ * On the stack a node comes with its father's id, or with VISITED when its sons are done.
+ */
+void TreeParams::setNodes(Node* root, bool countSubTr)
 {
-    vector<Node*> sons = root->getSons();        
-    for (vector<Node*>::iterator sonIt = sons.begin(); sonIt != sons.end(); sonIt++) {
-        int sonId = (*sonIt)->getId() - lSize;
-        if (sonId > 0) {
-            inSons[rootNewId].push_back(sonId);
-            setInSons(*sonIt, sonId);
-        }          
+    const int VISITED = -2;
+    vector<pair<Node*, int> > stack(1, make_pair(root, -1));
+    int leavesNum = 0;
+    int postorderNum = 0;
+    while (!stack.empty()) {
+        Node* node = stack.back().first;
+        int father = stack.back().second;
+        stack.pop_back();
+        int id = node->getId() - lSize;
+        if (id < 0) {
+            leafFather[node->getId()] = father;
+            leavesOrder[leavesNum++] = node->getId();
+        } else if (father == VISITED) {
+            inPostorder[postorderNum++] = id;
+            if (countSubTr) subTr[id] = leavesNum - firstLeaf[id];
+        } else {
+            inFather[id] = father;
+            firstLeaf[id] = leavesNum;
+            stack.push_back(make_pair(node, VISITED));
+            for (int s = node->getNumberOfSons() - 1; s >= 0; s--) {
+                stack.push_back(make_pair(node->getSon(s), id));
+            }
+        }
     }
 }
 
 
 Triplets::Triplets(const TreeTemplate<Node>& tr1In, const TreeTemplate<Node>& tr2In)
+{ 
+    init(tr1In, tr2In, NULL, NULL);
+}
+Triplets::Triplets(const PreparedTree& tr1In, const PreparedTree& tr2In)
+{ 
+    init(tr1In.getTree(), tr2In.getTree(), &tr1In.getSubtreeSizes(), &tr2In.getSubtreeSizes());
+}
+void Triplets::init(const TreeTemplate<Node>& tr1In, const TreeTemplate<Node>& tr2In, const vector<int>* subTrSizes1, const vector<int>* subTrSizes2)
 { 
     lSize = tr1In.getNumberOfLeaves();
     int inSize1 = tr1In.getNumberOfNodes() - lSize;
     Node* r1 = const_cast<Node*> (tr1In.getRootNode());
-    trP1 = new TreeParams(r1, inSize1, lSize);
+    trP1 = new TreeParams(r1, inSize1, lSize, subTrSizes1);
     int inSize2 = tr2In.getNumberOfNodes() - lSize;
     Node* r2 = const_cast<Node*> (tr2In.getRootNode());
-    trP2 = new TreeParams(r2, inSize2, lSize);
-
-    intersection = new int*[trP1->inSize * 2];
-    for (int i = 0; i < inSize1 * 2; i++) {
-        intersection[i] = new int[inSize2 * 2];
-        for (int j = 0; j < inSize2 * 2 + 1; j++) {
-            intersection[i][j] = -1;
-        }
+    trP2 = new TreeParams(r2, inSize2, lSize, subTrSizes2);
+
+    // the row of the root of tr1 is never read
+    intersection = new int*[inSize1];
+    for (int i = 0; i < inSize1; i++) {
+        intersection[i] = NULL;
+        if (i == trP1->rootId) continue;
+        intersection[i] = new int[inSize2];
+        countIntersectionRow(i);
     }
-    countIntersection(r1, r2, intersection);
 }
 
 Triplets::~Triplets()
 {
-    for (int i = 0; i < trP1->inSize * 2; i++) {
+    for (int i = 0; i < trP1->inSize; i++) {
         delete[] intersection[i];
     }
     delete[] intersection;
@@ -132,64 +164,49 @@ Triplets::~Triplets()
     delete trP2;
 }
 
-int Triplets::getDistance()
+int64_t Triplets::getDistance()
 {
-    int R1 = trP1->getResolved();
-    int U1 = trP1->getUnresolved(R1);
-    int U2 = trP2->getUnresolved(trP2->getResolved());
-    int S = getSameResolved();
-    int Rr1 = getResolvedT1();
+    int64_t R1 = trP1->getResolved();
+    int64_t U1 = trP1->getUnresolved(R1);
+    int64_t U2 = trP2->getUnresolved(trP2->getResolved());
+    int64_t S = getSameResolved();
+    int64_t Rr1 = getResolvedT1();
     return R1 - S + (U1 - U2) + Rr1;
 }
      
-int Triplets::countIntersection(Node* root1, Node* root2, int** intersection)
+/*
+ * The leaves under v1 are counted at their fathers in tr2, 
+ * then each internal node of tr2 adds its count to its father, in postorder.
+ */
+void Triplets::countIntersectionRow(int v1)
 {
-    int id1 = root1->getId() - lSize;
-    int id2 = root2->getId() - lSize;
-    bool internal = (min(id1, id2) >= 0) ? true : false;
-    //if the intersection was already considered
-    if (internal && intersection[id1][id2] != -1) return intersection[id1][id2];
-
-    int val = 0;
-    vector<Node*> s1 = root1->getSons();
-    vector<Node*> s2 = root2->getSons();
-
-    if (s1.size() == 0 && s2.size() == 0) {
-        return id1 == id2;
+    int* row = intersection[v1];
+    for (int v2 = 0; v2 < trP2->inSize; v2++) row[v2] = 0;
+    for (int k = trP1->firstLeaf[v1]; k < trP1->firstLeaf[v1] + trP1->subTr[v1]; k++) {
+        row[trP2->leafFather[trP1->leavesOrder[k]]]++;
     }
-
-    for (vector<Node*>::iterator it1 = s1.begin(); it1 != s1.end(); it1++) {
-        val += countIntersection(*it1, root2, intersection);
-        for (vector<Node*>::iterator it2 = s2.begin(); it2 != s2.end(); it2++) {
-            val -= countIntersection(*it1, *it2, intersection);            
-        }
-    }        
-    for (vector<Node*>::iterator it2 = s2.begin(); it2 != s2.end(); it2++) {
-        val += countIntersection(root1, *it2, intersection);
-    } 
-
-    if (internal) {
-        intersection[id1][id2] = val;
+    for (int k = 0; k < trP2->inSize; k++) {
+        int v2 = trP2->inPostorder[k];
+        if (trP2->inFather[v2] >= 0) row[trP2->inFather[v2]] += row[v2];
     }
-    return val;
 }   
 
-int Triplets::getSameResolved()
+int64_t Triplets::getSameResolved()
 {  
-    int res = 0;
+    int64_t res = 0;
     for (int i = 0; i < trP1->inSize; i++) {
         if (i != trP1->rootId) for (int j = 0; j < trP2->inSize; j++) {
             if (j != trP2->rootId) {
-                int pairs = TreeParams::choose2(intersection[i][j]);
-                for(list<int>::iterator itK = trP1->inSons[i].begin(); itK != trP1->inSons[i].end(); itK++) {
-                    for(list<int>::iterator itL = trP2->inSons[j].begin(); itL != trP2->inSons[j].end(); itL++) {
+                int64_t pairs = TreeParams::choose2(intersection[i][j]);
+                for(const int* itK = trP1->sonsBegin(i); itK != trP1->sonsEnd(i); itK++) {
+                    for(const int* itL = trP2->sonsBegin(j); itL != trP2->sonsEnd(j); itL++) {
                         pairs += TreeParams::choose2(intersection[*itK][*itL]);
                     }                        
                 }                    
-                for(list<int>::iterator itK = trP1->inSons[i].begin(); itK != trP1->inSons[i].end(); itK++) {
+                for(const int* itK = trP1->sonsBegin(i); itK != trP1->sonsEnd(i); itK++) {
                     pairs -= TreeParams::choose2(intersection[*itK][j]);
                 }
-                for(list<int>::iterator itL = trP2->inSons[j].begin(); itL != trP2->inSons[j].end(); itL++) {
+                for(const int* itL = trP2->sonsBegin(j); itL != trP2->sonsEnd(j); itL++) {
                     pairs -= TreeParams::choose2(intersection[i][*itL]);
                 }
 
@@ -201,13 +218,13 @@ int Triplets::getSameResolved()
     return res;
 }
 
-int Triplets::getResolvedT1()
+int64_t Triplets::getResolvedT1()
 {  
-    int res = 0;
+    int64_t res = 0;
     for (int i = 0; i < trP1->inSize; i++) {
         if (i != trP1->rootId) for (int j = 0; j < trP2->inSize; j++) {
             res += ro(i, i, j);
-            for(list<int>::iterator itK = trP1->inSons[i].begin(); itK != trP1->inSons[i].end(); itK++) {
+            for(const int* itK = trP1->sonsBegin(i); itK != trP1->sonsEnd(i); itK++) {
                 res -= ro(i, *itK, j);
             }
 
@@ -216,13 +233,13 @@ int Triplets::getResolvedT1()
     return res;
 }
 
-int Triplets::ro(int u2, int u, int v)
+int64_t Triplets::ro(int u2, int u, int v)
 {
-    int res = TreeParams::choose2(intersection[u][v]) * b_nega(v, u2);
-    for(list<int>::iterator itL = trP2->inSons[v].begin(); itL != trP2->inSons[v].end(); itL++) {
+    int64_t res = TreeParams::choose2(intersection[u][v]) * b_nega(v, u2);
+    for(const int* itL = trP2->sonsBegin(v); itL != trP2->sonsEnd(v); itL++) {
         res -= TreeParams::choose2(intersection[u][*itL]) * b_nega(*itL, u2);
         res -= TreeParams::choose2(intersection[u][*itL]) * (b_nega(v, u2) - b_nega(*itL, u2));
-        res -= intersection[u][*itL] * b_nega(*itL, u2) * (intersection[u][v] - intersection[u][*itL]);
+        res -= (int64_t) intersection[u][*itL] * b_nega(*itL, u2) * (intersection[u][v] - intersection[u][*itL]);
     }
     return res;
 }
@@ -0,0 +1,123 @@
+//
+// File: TripletDistanceHDT.cpp
+// Created by: agent
+// Created on: 17 October 2026
+//
+
+/*
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "TripletDistanceHDT.h"
+using namespace bpp;
+using namespace std;
+
+namespace tools {
+
+TripletsHDT::TripletsHDT(const TreeTemplate<Node>& tr1In, const TreeTemplate<Node>& tr2In)
+    throw (Exception)
+{
+    init(tr1In, tr2In, false);
+}
+TripletsHDT::TripletsHDT(const PreparedTree& tr1In, const PreparedTree& tr2In)
+    throw (Exception)
+{
+    init(tr1In.getTree(), tr2In.getTree(), false);
+}
+TripletsHDT::~TripletsHDT()
+{
+}
+
+int TripletsHDT::addPoly(bool hole)
+{
+    if (hole) {
+        HolePoly p = {0, {0, 0, 0}, {0, 0, 0}};
+        holePolys.push_back(p);
+        return holePolys.size() - 1;
+    }
+    freeCounts.push_back(0);
+    return freeCounts.size() - 1;
+}
+
+/*
+ * The node of the unit is the last common ancestor of the triplets with the pair 
+ * in the light subtree (the colours counts s) and the third leaf in the hole H, or the opposite.
+ */
+void TripletsHDT::countUnit(Component& unit)
+{
+    const Component& light = components[unit.left];
+    HolePoly& p = holePolys[unit.poly];
+    const int* s = light.cnt;
+    for (int k = 0; k < COLOURS; k++) unit.cnt[k] = s[k];
+
+    p.c = freeCounts[light.poly];
+    p.h[1] = choose2(s[2]);
+    p.h[2] = choose2(s[1]);
+    p.hh[1] = s[2];
+    p.hh[2] = s[1];
+}
+
+/*
+ * comp(H) = upper(lower + H) + lower(H), where lower denotes also the colours counts of the lower part.
+ */
+void TripletsHDT::countCompressed(Component& comp)
+{
+    const Component& upperComp = components[comp.left];
+    const Component& lowerComp = components[comp.right];
+    const HolePoly& a = holePolys[upperComp.poly];
+    const int* cb = lowerComp.cnt;
+    for (int k = 0; k < COLOURS; k++) comp.cnt[k] = upperComp.cnt[k] + cb[k];
+
+    int64_t c = a.c;
+    for (int k = 1; k < COLOURS; k++) {
+        c += a.h[k] * cb[k] + a.hh[k] * choose2(cb[k]);
+    }
+    if (comp.hole) {
+        const HolePoly& b = holePolys[lowerComp.poly];
+        HolePoly& p = holePolys[comp.poly];
+        p.c = c + b.c;
+        for (int k = 1; k < COLOURS; k++) {
+            p.h[k] = a.h[k] + a.hh[k] * cb[k] + b.h[k];
+            p.hh[k] = a.hh[k] + b.hh[k];
+        }
+    } else {
+        freeCounts[comp.poly] = c + freeCounts[lowerComp.poly];
+    }
+}
+
+int64_t TripletsHDT::getCounted()
+{
+    return freeCounts[components[rootComponent].poly];
+}
+
+int64_t TripletsHDT::getShared()
+{
+    if (lSize < 3) return 0;
+    int64_t shared = 0;
+    processPath(0, false, shared);
+    return shared;
+}
+
+int64_t TripletsHDT::getDistance()
+{
+    int64_t n = lSize;
+    if (n < 3) return 0;
+    int64_t all = n * (n - 1) / 2 * (n - 2) / 3;
+    return all - getShared();
+}
+
+} // end of namespace
@@ -23,6 +23,9 @@
 
 namespace tools {
     
+static int lap_do(int dim, cost **assigncost, col *rowsol, row *colsol, cost *u, cost *v,
+                  row *free, col *collist, col *matches, cost *d, row *pred);
+
 int lap(int dim, 
         cost **assigncost,
         col *rowsol, 
@@ -41,10 +44,9 @@ int lap(int dim,
 // v          - dual variables, column reduction numbers
 
 {
-  boolean unassignedfound;
-  row  i, imin, numfree = 0, prvnumfree, f, i0, k, freerow, *pred, *free;
-  col  j, j1, j2, endofpath, last, low, up, *collist, *matches;
-  cost min, h, umin, usubmin, v2, *d;
+  row *pred, *free;
+  col *collist, *matches;
+  cost *d;
 
   free = new row[dim];       // list of unassigned rows.
   collist = new col[dim];    // list of columns to be scanned in various ways.
@@ -52,6 +54,42 @@ int lap(int dim,
   d = new cost[dim];         // 'cost-distance' in augmenting path calculation.
   pred = new row[dim];       // row-predecessor of column in augmenting/alternating path.
 
+  cost lapcost = lap_do(dim, assigncost, rowsol, colsol, u, v, free, collist, matches, d, pred);
+
+  // free reserved memory.
+  delete[] pred;
+  delete[] free;
+  delete[] collist;
+  delete[] matches;
+  delete[] d;
+
+  return lapcost;
+}
+
+int lap(LapWorkspace& workspace)
+
+// input:
+// workspace  - the problem size and the cost matrix
+
+// output (in the workspace):
+// row solution, column solution, row and column dual variables
+
+{
+  return lap_do(workspace.getDim(), workspace.getCostRows(), 
+                workspace.getRowSolution(), workspace.getColSolution(), 
+                workspace.getRowDuals(), workspace.getColDuals(),
+                workspace.getFreeRows(), workspace.getColList(), workspace.getMatches(),
+                workspace.getDistances(), workspace.getPredecessors());
+}
+
+static int lap_do(int dim, cost **assigncost, col *rowsol, row *colsol, cost *u, cost *v,
+                  row *free, col *collist, col *matches, cost *d, row *pred)
+{
+  boolean unassignedfound;
+  row  i, imin, numfree = 0, prvnumfree, f, i0, k, freerow;
+  col  j, j1, j2, endofpath, last, low, up;
+  cost min, h, umin, usubmin, v2;
+
   // init how many times a row will be assigned in the column reduction.
   for (i = 0; i < dim; i++)  
     matches[i] = 0;
@@ -284,13 +322,6 @@ int lap(int dim,
     lapcost = lapcost + assigncost[i][j]; 
   }
 
-  // free reserved memory.
-  delete[] pred;
-  delete[] free;
-  delete[] collist;
-  delete[] matches;
-  delete[] d;
-
   return lapcost;
 }
 
@@ -94,6 +94,31 @@ public:
                 return (int)result;       
         }
         
+        /**
+         * @brief d(T1, T2) = ( add( abs( dist_a-b_Tr1 - dist_a-b_Tr2 ) ^ k ) ) ^ (1/k)
+         * with the paths counted in edges or, if weighted, in branch lengths.
+         */
+        static double nodalDistance(const Tree & tr1, const Tree & tr2, bool weighted, int k)
+                throw (Exception)
+        {
+                if(!VectorTools::haveSameElements(tr1.getLeavesNames(), tr2.getLeavesNames()))
+                        throw Exception("DiffetentLeavesSets [NaiveAlg]");
+
+                double result = 0;
+                vector<string> names = tr1.getLeavesNames();
+                map<string, int> leavesMap1, leavesMap2;
+                createTaxonsMap(tr1, leavesMap1);
+                createTaxonsMap(tr2, leavesMap2);
+                for (unsigned int v1 = 0; v1 < names.size(); v1++) {
+                        for (unsigned int v2 = v1+1; v2 < names.size(); v2++) {
+                                double distT1 = pathLength(tr1, leavesMap1.find(names[v1])->second, leavesMap1.find(names[v2])->second, weighted);
+                                double distT2 = pathLength(tr2, leavesMap2.find(names[v1])->second, leavesMap2.find(names[v2])->second, weighted);
+                                result += std::pow(std::fabs(distT1 - distT2), k);
+                        }
+                }
+                return std::pow(result, 1 / (double)k);
+        }
+        
         static int tripletsDistance(const Tree& tr1, const Tree& tr2)
                         throw (Exception)
         {
@@ -139,6 +164,14 @@ private:
                 return std::abs(a - b);
         }
 
+        static double pathLength(const Tree & tree, int a, int b, bool weighted)
+        {
+                if (weighted) {
+                        return TreeTools::getDistanceBetweenAnyTwoNodes(tree, a, b);
+                }
+                return (double)TreeTools::getPathBetweenAnyTwoNodes(tree, a, b).size();
+        }
+
 
         static void createTaxonsMap(const Tree & tr, map<string, int> & leavesMap)
         {
@@ -40,6 +40,8 @@ using namespace bpp;
 using namespace dist;
 
 RootedTrees trees;
+
+typedef SettingGuard<bool, INodesDist::isGenericImplementationForced, INodesDist::forceGenericImplementation> NodalKernelsGuard;
 /*
 BOOST_AUTO_TEST_SUITE( ConstraintsChecking )
 
@@ -147,6 +149,65 @@ BOOST_AUTO_TEST_CASE( Correctness )
 }
 BOOST_AUTO_TEST_SUITE_END() // Pythagorean_metric
 
+BOOST_AUTO_TEST_SUITE( Weighted_metric)
+
+BOOST_AUTO_TEST_CASE( PathsToDifferentDepthsCountTheirOwnBranches )
+{
+    vector<Tree*> trees;
+    Reader::getTrees ("((a:1,b:2):3,c:4,(d:5,e:6):7);\n((a:1,c:2):3,b:4,(d:5,e:6):7);\n", trees);
+    BOOST_CHECK_CLOSE(PhylotreeDist::nodalDistanceW(*trees.at(0), *trees.at(1)), 14.0, 1e-9);
+    BOOST_CHECK_CLOSE(PhylotreeDist::nodalDistanceW(*trees.at(1), *trees.at(0)), 14.0, 1e-9);
+}
+
+BOOST_AUTO_TEST_SUITE_END() // Weighted_metric
+
+BOOST_AUTO_TEST_CASE( OneToManyGivesThePairsDistances )
+{
+    vector<Tree*> trees;
+    Reader::getTrees ("((a:1,b:2):3,c:4,(d:5,e:6):7);\n((a:1,c:2):3,b:4,(d:5,e:6):7);\n(a:1,(b:2,c:3):4,(d:5,e:6):7);\n", trees);
+    PreparedTree reference(*trees.at(0));
+    vector<PreparedTree*> others;
+    others.push_back(new PreparedTree(*trees.at(1)));
+    others.push_back(new PreparedTree(*trees.at(2)));
+    vector<double> distances = PhylotreeDist::nodalDistances(reference, others, true, 2);
+    for (int i = 0; i < 2; i++) {
+        BOOST_CHECK_CLOSE(distances.at(i), PhylotreeDist::nodalDistanceW_pythagorean(reference, *others.at(i)), 1e-9);
+        delete others.at(i);
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE( KernelsGiveTheNaiveDistances, NodalKernelsGuard )
+{
+    // The rows of 37 leaves end with the tails of the 4 and 8 lanes wide vectors
+    vector<Tree*> trees;
+    Reader::getTrees ("(((((t24:1,t35:3):2,t27:1.5):1,(t29:3,t2:1.5):4.5):2,(t10:1.5,t30:2.5):2):1.5,((t22:0.5,(((t0:3,t33:1):4,"
+                    "((t4:1.5,(t19:3,t1:2.5,t23:4.5):3):2,(t3:4.5,t17:0.5):1.5):2,t25:2.5):1.5,(t12:1,t13:4):4):4):0.5,"
+                    "(t11:3,(t6:2,(t15:4,t31:4):4.5):0.5):4):1.5,((t20:2.5,t8:1):0.5,((t34:3,(t18:4.5,(t21:4,t26:2.5,t32:4.5):4):0.5):0.5,"
+                    "((t28:1.5,((t7:3,t14:3.5):2.5,t9:0.5):3):4,t36:4.5):1.5):4,(t5:0.5,t16:1.5):4.5):4.5);\n"
+                    "((t3:1.5,(((t1:4,t9:4,(t6:4.5,t18:0.5):2):2,t19:4,t28:1.5):4.5,(t14:1.5,t4:1.5,(t26:2,(t27:2.5,t31:2):3,t11:2):2):1,"
+                    "(t17:4.5,t35:4.5):1.5):3.5,t0:1.5):3.5,(t10:1.5,t36:3.5):2.5,(((t32:3,t2:3):0.5,((((t29:1.5,t12:0.5,(t8:3.5,t15:2):4.5):2.5,"
+                    "((t22:4.5,(t24:1.5,t7:4.5):1):3.5,(t34:2.5,t20:4):3):4.5):2.5,(t13:2,t25:1):3.5):1,((t33:3.5,t5:1.5,(t30:1,t21:4.5):4.5):3.5,"
+                    "t16:0.5):3.5):4):3.5,t23:2):2);\n", trees);
+    Tree& tr1 = *trees.at(0);
+    Tree& tr2 = *trees.at(1);
+    double distances[2][4];
+    for (int generic = 0; generic < 2; generic++) {
+        INodesDist::forceGenericImplementation(generic == 1);
+        distances[generic][0] = PhylotreeDist::nodalDistance(tr1, tr2);
+        distances[generic][1] = PhylotreeDist::nodalDistance_pythagorean(tr1, tr2);
+        distances[generic][2] = PhylotreeDist::nodalDistanceW(tr1, tr2);
+        distances[generic][3] = PhylotreeDist::nodalDistanceW_pythagorean(tr1, tr2);
+        BOOST_CHECK_CLOSE(distances[generic][0], NaiveAlgorithms::nodalDistance(tr1, tr2, false, 1), 1e-9);
+        BOOST_CHECK_CLOSE(distances[generic][1], NaiveAlgorithms::nodalDistance(tr1, tr2, false, 2), 1e-9);
+        BOOST_CHECK_CLOSE(distances[generic][2], NaiveAlgorithms::nodalDistance(tr1, tr2, true, 1), 1e-9);
+        BOOST_CHECK_CLOSE(distances[generic][3], NaiveAlgorithms::nodalDistance(tr1, tr2, true, 2), 1e-9);
+    }
+    // The kernels chosen for the CPU sum in the same order as the generic ones
+    for (int i = 0; i < 4; i++) {
+        BOOST_CHECK_EQUAL(distances[0][i], distances[1][i]);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END() //Correctness 
 
 
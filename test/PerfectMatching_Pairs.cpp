@@ -41,6 +41,16 @@ BOOST_AUTO_TEST_CASE( SameTree )
             PhylotreeDist::perfectMatching_pairs(*trees[35], *trees[35]), 
             0);
 }
+BOOST_AUTO_TEST_CASE( MultifurcatingTree )
+{
+    vector<Tree*> trees;
+    Reader::getTrees ("((a,b,c),d);\n"
+                    "(((a,b),c),d);\n", trees);
+    // ab,ac,bc|ad,bd,cd against ab|ac,bc|ad,bd,cd: the dummy element gets ab
+    BOOST_CHECK_EQUAL(
+            PhylotreeDist::perfectMatching_pairs(*trees.at(0), *trees.at(1)), 
+            2);
+}
         
         
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
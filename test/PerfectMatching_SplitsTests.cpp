@@ -36,6 +36,10 @@ using namespace std;
 
 UnrootedTrees trees;
 
+typedef SettingGuard<PhylotreeDist::MatchingAlgorithm, PhylotreeDist::getMatchingAlgorithm, PhylotreeDist::setMatchingAlgorithm> MatchingAlgorithmGuard;
+typedef SettingGuard<int, AuctionSolver::getThreadsNumber, AuctionSolver::setThreadsNumber> AuctionThreadsGuard;
+struct ThreadedAuctionGuard : MatchingAlgorithmGuard, AuctionThreadsGuard {};
+
 BOOST_AUTO_TEST_SUITE( Correctness )
 BOOST_AUTO_TEST_CASE( SameTrees )
 {
@@ -69,6 +73,43 @@ BOOST_AUTO_TEST_CASE( BogdamowiczJava )
 	BOOST_CHECK_EQUAL(PhylotreeDist::perfectMatching_splits(*trees.at(i), *trees.at(i+1)),	9);
 	i++;
 }
+BOOST_AUTO_TEST_CASE( BoundedDecidesAsExact )
+{
+	vector<Tree *> trees;
+	Reader::getTreesFromFile("data/u17-PMSplits_BogdamowiczJava.newick", trees);
+	for (unsigned int i = 0; i + 1 < trees.size(); i++) {
+		int distance = PhylotreeDist::perfectMatching_splits(*trees.at(i), *trees.at(i+1));
+		BOOST_CHECK(PhylotreeDist::perfectMatching_splits_bounded(*trees.at(i), *trees.at(i+1), distance));
+		BOOST_CHECK(!PhylotreeDist::perfectMatching_splits_bounded(*trees.at(i), *trees.at(i+1), distance - 1));
+	}
+}
+BOOST_FIXTURE_TEST_CASE( AllMatchingSolversSameAsJonkerVolgenant, MatchingAlgorithmGuard )
+{
+	vector<Tree *> trees;
+	Reader::getTreesFromFile("data/u17-PMSplits_BogdamowiczJava.newick", trees);
+	for (unsigned int i = 0; i + 1 < trees.size(); i++) {
+		PhylotreeDist::setMatchingAlgorithm(PhylotreeDist::JONKER_VOLGENANT);
+		int expected = PhylotreeDist::perfectMatching_splits(*trees.at(i), *trees.at(i+1));
+		PhylotreeDist::setMatchingAlgorithm(PhylotreeDist::HUNGARIAN_ALGORITHM);
+		BOOST_CHECK_EQUAL(PhylotreeDist::perfectMatching_splits(*trees.at(i), *trees.at(i+1)), expected);
+		PhylotreeDist::setMatchingAlgorithm(PhylotreeDist::AUCTION_ALGORITHM);
+		BOOST_CHECK_EQUAL(PhylotreeDist::perfectMatching_splits(*trees.at(i), *trees.at(i+1)), expected);
+	}
+}
+BOOST_FIXTURE_TEST_CASE( ThreadedAuctionSameAsJonkerVolgenant, ThreadedAuctionGuard )
+{
+	// Over 1024 splits are left after removing the common ones, so the bids are searched by the threads
+	int n = 1100;
+	vector<Tree *> trees;
+	Reader::getTrees("(" + NewickGenerator::balanced(0, n / 3) + "," + NewickGenerator::balanced(n / 3, 2 * n / 3) + ","
+			+ NewickGenerator::balanced(2 * n / 3, n) + ");\n"
+			"(t0,t1," + NewickGenerator::caterpillar(2, n) + ");\n", trees);
+	PhylotreeDist::setMatchingAlgorithm(PhylotreeDist::JONKER_VOLGENANT);
+	int expected = PhylotreeDist::perfectMatching_splits(*trees.at(0), *trees.at(1));
+	PhylotreeDist::setMatchingAlgorithm(PhylotreeDist::AUCTION_ALGORITHM);
+	AuctionSolver::setThreadsNumber(4);
+	BOOST_CHECK_EQUAL(PhylotreeDist::perfectMatching_splits(*trees.at(0), *trees.at(1)), expected);
+}
 BOOST_AUTO_TEST_SUITE_END() //Correctness
 
         
@@ -0,0 +1,135 @@
+//
+// File: QuartetDistanceTests.cpp
+// Created by: agent
+// Created on: 17 October 2026
+//
+
+/*
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define BOOST_TEST_MODULE quartetDistance
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <PhylotreeDist.h>
+#include <Phyl/Tree.h>
+#include "TestedTreesInstances.h"
+
+using namespace dist;
+
+typedef SettingGuard<PhylotreeDist::QuartetAlgorithm, PhylotreeDist::getQuartetAlgorithm, PhylotreeDist::setQuartetAlgorithm> QuartetAlgorithmGuard;
+typedef SettingGuard<int, QuartetDistance::getThreadsNumber, QuartetDistance::setThreadsNumber> QuartetThreadsGuard;
+
+/**
+ * Compares the arbitrary degree and the hierarchical decomposition algorithms 
+ * on the unrooted caterpillar and the balanced tree of n leaves.
+ */
+void checkAlgorithmsGiveTheSameDistance(int n)
+{
+    string caterpillar = "(t0,t1," + NewickGenerator::caterpillar(2, n) + ");\n";
+    stringstream binary;
+    binary << "(" << NewickGenerator::balanced(0, n / 3) << "," << NewickGenerator::balanced(n / 3, 2 * n / 3) << "," << NewickGenerator::balanced(2 * n / 3, n) << ");\n";
+    vector<Tree*> trees;
+    Reader::getTrees (caterpillar + binary.str(), trees);
+    PhylotreeDist::setQuartetAlgorithm(PhylotreeDist::QUARTET_ARBITRARY_DEGREE);
+    int64_t arbitraryDegree = PhylotreeDist::quartetDistance(*trees.at(0), *trees.at(1));
+    PhylotreeDist::setQuartetAlgorithm(PhylotreeDist::QUARTET_HIERARCHICAL_DECOMPOSITION);
+    int64_t hierarchicalDecomposition = PhylotreeDist::quartetDistance(*trees.at(0), *trees.at(1));
+    BOOST_CHECK_EQUAL(arbitraryDegree, hierarchicalDecomposition);
+}
+
+BOOST_AUTO_TEST_SUITE( Correctness )
+BOOST_AUTO_TEST_CASE( SameTree )
+{
+    vector<Tree*> trees;
+    Reader::getTrees ("((a,b),c,(d,(e,f)));\n", trees);
+    BOOST_CHECK_EQUAL(PhylotreeDist::quartetDistance(*trees.at(0), *trees.at(0)), 0);
+}
+BOOST_AUTO_TEST_CASE( SwappedLeaves )
+{
+    vector<Tree*> trees;
+    Reader::getTrees ("((a,b),c,(d,(e,f)));\n"
+                    "((a,f),c,(d,(e,b)));\n", trees);
+    // only the quartet acde keeps its topology
+    BOOST_CHECK_EQUAL(PhylotreeDist::quartetDistance(*trees.at(0), *trees.at(1)), 14);
+}
+BOOST_AUTO_TEST_CASE( InternalNodesWithSeveralInternalSons )
+{
+    vector<Tree*> trees;
+    Reader::getTrees ("(((a,b),(c,d),e),f,(g,h));\n"
+                    "(((a,c),(b,h),e),g,(f,d));\n", trees);
+    // counted by brute force over all the 70 quartets
+    BOOST_CHECK_EQUAL(PhylotreeDist::quartetDistance(*trees.at(0), *trees.at(1)), 55);
+}
+BOOST_AUTO_TEST_CASE( LargeTreesCountsDoNotOverflow )
+{
+    // All the quartets are unresolved in the star and resolved in the binary tree
+    int n = 1250;
+    stringstream star;
+    star << "(t0";
+    for (int i = 1; i < n; i++) star << ",t" << i;
+    star << ");\n";
+    stringstream binary;
+    binary << "(" << NewickGenerator::balanced(0, n / 3) << "," << NewickGenerator::balanced(n / 3, 2 * n / 3) << "," << NewickGenerator::balanced(2 * n / 3, n) << ");\n";
+    vector<Tree*> trees;
+    Reader::getTrees (star.str() + binary.str(), trees);
+    BOOST_CHECK_EQUAL(PhylotreeDist::quartetDistance(*trees.at(0), *trees.at(1)), 101237695000LL);
+}
+BOOST_FIXTURE_TEST_CASE( AlgorithmsGiveTheSameDistance, QuartetAlgorithmGuard )
+{
+    checkAlgorithmsGiveTheSameDistance(300);
+}
+BOOST_FIXTURE_TEST_CASE( DeepCaterpillarGivesTheSameDistance, QuartetAlgorithmGuard )
+{
+    // The caterpillar is the deepest unrooted tree, its internal nodes make a path of n - 2
+    checkAlgorithmsGiveTheSameDistance(3000);
+}
+BOOST_FIXTURE_TEST_CASE( ThreadsGiveTheSameDistance, QuartetThreadsGuard )
+{
+    // Multifurcating trees go to QuartetDistance, the first one has enough internal nodes for the threads
+    vector<Tree*> trees;
+    Reader::getTrees ("(" + NewickGenerator::balanced(0, 100) + ",(t100,t101," + NewickGenerator::caterpillar(102, 200) + "),"
+                        + NewickGenerator::caterpillar(200, 300) + ");\n"
+                    "((t0,t1,t2)," + NewickGenerator::balanced(3, 150) + "," + NewickGenerator::caterpillar(150, 300) + ");\n", trees);
+    QuartetDistance::setThreadsNumber(1);
+    int64_t serial = PhylotreeDist::quartetDistance(*trees.at(0), *trees.at(1));
+    QuartetDistance::setThreadsNumber(4);
+    BOOST_CHECK_EQUAL(PhylotreeDist::quartetDistance(*trees.at(0), *trees.at(1)), serial);
+}
+BOOST_AUTO_TEST_SUITE_END() //Correctness
+
+
+BOOST_AUTO_TEST_SUITE( ConstraintsChecking )
+
+BOOST_AUTO_TEST_CASE( RootedTreesThrowException )
+{
+    vector<Tree*> trees;
+    Reader::getTrees ("((a,b),(c,d));\n"
+                    "(a,b,(c,d));\n", trees);
+    BOOST_CHECK_THROW(PhylotreeDist::quartetDistance(*trees.at(0), *trees.at(1), true), Exception);
+}
+BOOST_FIXTURE_TEST_CASE( HierarchicalDecompositionMultifurcatingTreesThrowException, QuartetAlgorithmGuard )
+{
+    vector<Tree*> trees;
+    Reader::getTrees ("(a,b,(c,d,e));\n"
+                    "(a,b,(c,(d,e)));\n", trees);
+    PhylotreeDist::setQuartetAlgorithm(PhylotreeDist::QUARTET_HIERARCHICAL_DECOMPOSITION);
+    BOOST_CHECK_THROW(PhylotreeDist::quartetDistance(*trees.at(0), *trees.at(1)), Exception);
+}
+
+BOOST_AUTO_TEST_SUITE_END() //ConstraintsChecking
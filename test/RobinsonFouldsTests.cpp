@@ -78,6 +78,63 @@ BOOST_AUTO_TEST_CASE( RootedTrees )
         }	
 }
 
+BOOST_AUTO_TEST_CASE( PreparedTrees )
+{
+	for (int i = 0; i < unrootedTrees.size() - 1; i++) {
+                PreparedTree prepared1(*unrootedTrees.at(i));
+                PreparedTree prepared2(*unrootedTrees.at(i+1));
+                BOOST_CHECK_EQUAL(PhylotreeDist::robinsonFoulds(*unrootedTrees.at(i), *unrootedTrees.at(i+1), true),
+                        PhylotreeDist::robinsonFoulds(prepared1, prepared2));
+        }
+	for (int i = 0; i < rootedTrees.size() - 1; i++) {
+                PreparedTree prepared1(*rootedTrees.at(i));
+                PreparedTree prepared2(*rootedTrees.at(i+1));
+                BOOST_CHECK_EQUAL(PhylotreeDist::robinsonFoulds(*rootedTrees.at(i), *rootedTrees.at(i+1), true),
+                        PhylotreeDist::robinsonFoulds(prepared1, prepared2));
+        }
+}
+
+BOOST_AUTO_TEST_CASE( ReferenceTree )
+{
+        RFReference reference(*unrootedTrees.at(0));
+        vector<TreeTemplate<Node>*> queries;
+	for (int i = 1; i < unrootedTrees.size(); i++) {
+                if (VectorTools::haveSameElements(unrootedTrees.at(0)->getLeavesNames(), unrootedTrees.at(i)->getLeavesNames()))
+                        queries.push_back(unrootedTrees.at(i));
+        }
+        vector<int> distances = reference.getDistances(queries);
+	for (int i = 0; i < queries.size(); i++) {
+                BOOST_CHECK_EQUAL(PhylotreeDist::robinsonFoulds(*unrootedTrees.at(0), *queries.at(i), true), distances.at(i));
+                BOOST_CHECK_EQUAL(reference.getDistance(*queries.at(i)), distances.at(i));
+        }
+}
+
+BOOST_AUTO_TEST_CASE( TreesCollection )
+{
+        vector<TreeTemplate<Node>*> trees;
+	for (int i = 0; i < unrootedTrees.size(); i++) {
+                if (VectorTools::haveSameElements(unrootedTrees.at(0)->getLeavesNames(), unrootedTrees.at(i)->getLeavesNames()))
+                        trees.push_back(unrootedTrees.at(i));
+        }
+        HashRF hashRF(trees);
+	for (int i = 0; i < trees.size(); i++) {
+                for (int j = i + 1; j < trees.size(); j++) {
+                        BOOST_CHECK_EQUAL(PhylotreeDist::robinsonFoulds(*trees.at(i), *trees.at(j), true), hashRF.getDistance(i, j));
+                }
+        }
+}
+
+BOOST_AUTO_TEST_CASE( TriangleIndexOfLargeCollections )
+{
+        // the pairs of 100000 trees do not fit int
+        int n = 100000;
+        BOOST_CHECK_EQUAL(HashRF::getTriangleSize(n), 4999950000LL);
+        BOOST_CHECK_EQUAL(HashRF::getTriangleIndex(0, 1, n), 0);
+        BOOST_CHECK_EQUAL(HashRF::getTriangleIndex(1, 2, n), n - 1);
+        BOOST_CHECK_EQUAL(HashRF::getTriangleIndex(n / 2, n / 2 + 1, n), HashRF::getTriangleIndex(n / 2 - 1, n - 1, n) + 1);
+        BOOST_CHECK_EQUAL(HashRF::getTriangleIndex(n - 2, n - 1, n), HashRF::getTriangleSize(n) - 1);
+}
+
 BOOST_AUTO_TEST_SUITE_END() //Correctness
 
 BOOST_AUTO_TEST_SUITE( ConstraintsChecking )
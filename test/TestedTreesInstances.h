@@ -55,6 +55,46 @@ public:
 		n.read(istr, trees);
 	}
 };
+/**
+ * Newick subtrees over the leaves t<begin>, ..., t<end - 1> for the tests on large trees.
+ * A rooted tree is a subtree followed by ";", an unrooted one joins three subtrees,
+ * e.g. "(" + balanced(0, n / 2) + ",t" + n / 2 + "," + caterpillar(n / 2 + 1, n) + ");".
+ */
+class NewickGenerator
+{
+public:
+	static string balanced(int begin, int end)
+	{
+		stringstream ss;
+		if (end - begin == 1) {
+			ss << "t" << begin;
+		} else {
+			int middle = (begin + end) / 2;
+			ss << "(" << balanced(begin, middle) << "," << balanced(middle, end) << ")";
+		}
+		return ss.str();
+	}
+	static string caterpillar(int begin, int end)
+	{
+		stringstream ss;
+		for (int i = begin; i < end - 1; i++) ss << "(t" << i << ",";
+		ss << "t" << end - 1 << string(end - 1 - begin, ')');
+		return ss.str();
+	}
+};
+/**
+ * Restores a static setting of the library (read with get, written with set) at the end 
+ * of the tests changing it, also when they fail, e.g.
+ * typedef SettingGuard<int, QuartetDistance::getThreadsNumber, QuartetDistance::setThreadsNumber> QuartetThreadsGuard;
+ * BOOST_FIXTURE_TEST_CASE( ThreadsGiveTheSameDistance, QuartetThreadsGuard )
+ */
+template <typename T, T (*get)(), void (*set)(T)>
+struct SettingGuard
+{
+	T saved;
+	SettingGuard() : saved(get()) {}
+	~SettingGuard() { set(saved); }
+};
 class Trees
 {
 protected:
@@ -41,6 +41,23 @@ using namespace dist;
 
 RootedTrees trees;
 
+typedef SettingGuard<PhylotreeDist::TripletAlgorithm, PhylotreeDist::getTripletAlgorithm, PhylotreeDist::setTripletAlgorithm> TripletAlgorithmGuard;
+
+/**
+ * Compares the arbitrary degree and the hierarchical decomposition algorithms 
+ * on the rooted caterpillar and the balanced tree of n leaves.
+ */
+void checkAlgorithmsGiveTheSameDistance(int n)
+{
+    vector<Tree*> trees;
+    Reader::getTrees (NewickGenerator::caterpillar(0, n) + ";\n" + NewickGenerator::balanced(0, n) + ";\n", trees);
+    PhylotreeDist::setTripletAlgorithm(PhylotreeDist::TRIPLET_ARBITRARY_DEGREE);
+    int64_t arbitraryDegree = PhylotreeDist::tripletsDistance(*trees.at(0), *trees.at(1));
+    PhylotreeDist::setTripletAlgorithm(PhylotreeDist::TRIPLET_HIERARCHICAL_DECOMPOSITION);
+    int64_t hierarchicalDecomposition = PhylotreeDist::tripletsDistance(*trees.at(0), *trees.at(1));
+    BOOST_CHECK_EQUAL(arbitraryDegree, hierarchicalDecomposition);
+}
+
 BOOST_AUTO_TEST_SUITE( Correctness )
 
 BOOST_AUTO_TEST_CASE( Correctness )
@@ -60,6 +77,32 @@ BOOST_AUTO_TEST_CASE( Correctness )
         }	
 }
 
+BOOST_AUTO_TEST_CASE( LargeTreesCountsDoNotOverflow )
+{
+    // The triplets with the leaf z agree, the others are unresolved only in the first tree
+    int n = 2500;
+    stringstream star;
+    star << "((t0";
+    for (int i = 1; i < n; i++) star << ",t" << i;
+    star << "),z);\n";
+    stringstream binary;
+    binary << "(" << NewickGenerator::balanced(0, n) << ",z);\n";
+    vector<Tree*> trees;
+    Reader::getTrees (star.str() + binary.str(), trees);
+    BOOST_CHECK_EQUAL(PhylotreeDist::tripletsDistance(*trees.at(0), *trees.at(1)), 2601042500LL);
+}
+
+BOOST_FIXTURE_TEST_CASE( AlgorithmsGiveTheSameDistance, TripletAlgorithmGuard )
+{
+    checkAlgorithmsGiveTheSameDistance(300);
+}
+
+BOOST_FIXTURE_TEST_CASE( DeepCaterpillarGivesTheSameDistance, TripletAlgorithmGuard )
+{
+    // The caterpillar is the deepest rooted tree, its internal nodes make a path of n - 1
+    checkAlgorithmsGiveTheSameDistance(5000);
+}
+
 BOOST_AUTO_TEST_SUITE_END() //Correctness
 
 